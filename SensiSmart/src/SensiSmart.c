@@ -34,62 +34,94 @@
 #include <pebble.h>
 #include "backpack.h"
 #include "SensiSmartApp.h"
+#include "startup.h"
 #include "utils.h"
-//#include "app_airtouch.h"
-//#include "app_thermal_context.h"
-#include "app_perspiration_chart.h"
-//#include "app_feellike.h"
-#include "app_logger.h"
-#include "app_version.h"
-//#include "app_onbody_demo.h"
-//#include "app_raw.h"
-//#include "app_temp_compensation.h"
-//#include "app_thermal_values.h"
+#include "log_export.h"
+#include "scheduler.h"
+#include "screen_config.h"
+#include "screens.auto.h"
 
-/* Keep the list in sync with the apps array below */
-enum AppList {
-
-  //APP_THERMAL_CONTEXT,
-  //APP_THERMAL_VALUES,
-  //APP_AIRTOUCH,
-  APP_LOGGER,
-  APP_VERSION,
-  //APP_ONBODY_DEMO,
-  APP_PERSPIRATION_CHART,
-  //APP_RAW,
-  //APP_FEELLIKE,
-  //APP_TEMP_COMPENSATION,
-  NUM_APPS
+/**
+ * Catalog of the screens compiled in, generated from screens.json
+ * The ids are stable and used by the persisted screen configuration.
+ */
+static const struct {
+  uint8_t id;
+  SensiSmartApp *app;
+} screens[] = {
+  SCREEN_CATALOG
 };
+#define NUM_SCREENS ARRAY_LENGTH(screens)
 
-/* Keep the list in sync with the app list enum above */
-static SensiSmartApp *apps[] = {
-  //&AppThermalContext,
-  //&AppThermalValues,
-  //&AppAirtouch,
-  &AppLogger,
-  &AppVersion,
-  //&AppOnbodyDemo,
-  &AppPerspirationChart,
-  //&AppRaw,
-  //&AppFeellike,
-  //&AppTempCompensation,
-  NULL
+/** Screens shown when no valid configuration is stored */
+static const uint8_t default_screens[] = {
+  SCREEN_DEFAULTS
 };
 
+static SensiSmartApp *apps[NUM_SCREENS + 1];
+
+static SensiSmartApp *find_screen(uint8_t id) {
+  for (unsigned i = 0; i < NUM_SCREENS; ++i) {
+    if (screens[i].id == id)
+      return screens[i].app;
+  }
+  return NULL;
+}
+
+/**
+ * Fill the apps array from a screen configuration, unknown and duplicate ids
+ * are skipped
+ *
+ * @return the number of apps
+ */
+static int select_screens(const uint8_t *ids, int num_ids) {
+  int num_apps = 0;
+  for (int i = 0; i < num_ids; ++i) {
+    SensiSmartApp *app = find_screen(ids[i]);
+    if (!app) {
+      WARN("Unknown screen id %d", ids[i]);
+      continue;
+    }
+    bool dup = false;
+    for (int j = 0; j < num_apps; ++j)
+      dup |= apps[j] == app;
+    if (!dup)
+      apps[num_apps++] = app;
+  }
+  apps[num_apps] = NULL;
+  return num_apps;
+}
+
+static int load_screens() {
+  uint8_t ids[SCREEN_CONFIG_MAX_SCREENS];
+  int num_apps = select_screens(ids, screen_config_load(ids, ARRAY_LENGTH(ids)));
+  if (!num_apps)
+    num_apps = select_screens(default_screens, ARRAY_LENGTH(default_screens));
+  return num_apps;
+}
+
 static int init() {
   int ret = bp_init();
-  sensismart_app_init(NUM_APPS, apps);
+  startup_mark(STARTUP_BP_INIT);
+  screen_config_listen();
+  app_message_open(SCREEN_CONFIG_INBOX_SIZE, log_export_outbox_size());
+  sensismart_app_init(load_screens(), apps);
+  startup_mark(STARTUP_APP_INIT);
   sensismart_app_next();
+  startup_mark(STARTUP_FIRST_SCREEN);
   return ret;
 }
 
 static void deinit() {
+  /* report the reached phases of an incomplete startup */
+  startup_report();
+  sched_log_stats();
   sensismart_app_deinit();
   bp_deinit();
 }
 
 int main() {
+  startup_mark(STARTUP_MAIN);
   DBG("STARTING APP");
   if (init())
     app_event_loop();
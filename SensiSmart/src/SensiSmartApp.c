@@ -32,17 +32,87 @@
 
 #include <pebble.h>
 #include "SensiSmartApp.h"
+#include "backpack.h"
+#include "scheduler.h"
+#include "startup.h"
 #include "utils.h"
 
 static const char *BACKPACK_DISCONNECTED_TEXT = "Searching for\nBackpack...";
 static const int DIALOG_HEIGHT = 60;
 static const int DIALOG_WIDTH = 144;
+static const uint8_t DEFAULT_MAX_FRAME_RATE = 4;
+
+#define BITMAP_CACHE_SIZE 8
+/** Heap kept by cached bitmaps which are not in use */
+static const uint32_t BITMAP_CACHE_UNUSED_BUDGET = 8 * 1024;
+
+struct bitmap_cache_entry {
+  GBitmap *bitmap;
+  uint32_t resource_id;
+  uint32_t size;
+  uint16_t refs;
+  /** last use for the eviction of unused bitmaps */
+  uint16_t last_use;
+};
+
+static struct bitmap_cache_entry bitmap_cache[BITMAP_CACHE_SIZE];
+static uint16_t bitmap_cache_clock;
+static uint32_t bitmap_cache_unused_bytes;
+/** Delay to collect the updates of reads completing back to back */
+static const uint32_t RENDER_COALESCE_MS = 50;
+/** Idle apps may be unloaded this much later to share a wakeup */
+static const uint32_t IDLE_UNLOAD_SLACK_MS = 5000;
 static GBitmap *res_branding_logo;
 static BitmapLayer *branding_layer;
 
+typedef struct Dialog {
+  Layer *layer;
+  GBitmap *res_icon;
+  BitmapLayer *icon_layer;
+  TextLayer *text_layer;
+} Dialog;
+
+static Dialog disconnect_dialog;
+
+enum ui_object_type {
+  UI_TEXT_LAYER,
+  UI_BITMAP_LAYER,
+  UI_LAYER,
+  UI_GPATH
+};
+
+struct ui_object {
+  void *object;
+  enum ui_object_type type;
+};
+
 static int num_apps = 0;
 static int current_app = -1;
 static SensiSmartApp **registered_apps;
+static SchedTimer render_timer;
+static uint64_t last_render_ms;
+
+/** Framework state of the registered apps */
+static struct app_state {
+  /** heap used by the window and its layers */
+  size_t window_heap;
+  uint32_t last_used;
+  /** time the app was last active or loaded */
+  uint64_t last_active_ms;
+  bool loaded;
+  bool uses_branding;
+  struct sensismart_heap_stats heap;
+  /** UI objects of the screen in order of creation */
+  struct ui_object *ui_objects;
+  uint8_t num_ui_objects;
+  uint8_t max_ui_objects;
+} *app_states;
+static uint32_t app_switch_count;
+static size_t window_budget = 4 * 1024;
+/** Inactive windows never keep more than this share of the free heap */
+static const uint32_t WINDOW_BUDGET_FREE_DIVISOR = 4;
+static uint32_t idle_unload_ms;
+static SchedTimer idle_timer;
 
 static void on_click_back(ClickRecognizerRef recognizer, void *context) {
   /* DO NOTHING (long pressing will still exit) */
@@ -56,43 +126,481 @@ static void on_click_down(ClickRecognizerRef recognizer, void *context) {
   sensismart_app_next();
 }
 
+static void cancel_render() {
+  if (render_timer) {
+    sched_cancel(render_timer);
+    render_timer = SCHED_TIMER_NONE;
+  }
+}
+
+static void heap_sample(int app_idx) {
+  struct sensismart_heap_stats *stats = &app_states[app_idx].heap;
+  uint32_t used = heap_bytes_used();
+  uint32_t free = heap_bytes_free();
+  if (used > stats->peak_used)
+    stats->peak_used = used;
+  if (free < stats->min_free || !stats->min_free)
+    stats->min_free = free;
+}
+
+static void heap_record_activate(int app_idx, size_t heap_before) {
+  struct sensismart_heap_stats *stats = &app_states[app_idx].heap;
+  stats->activate = (int32_t) (heap_bytes_used() - heap_before);
+  stats->held += stats->activate;
+  stats->activations += 1;
+  heap_sample(app_idx);
+  INFO("Heap %s: %d B on activate, %d B held, %u B used, %u B free",
+       registered_apps[app_idx]->name, (int) stats->activate,
+       (int) stats->held, (unsigned) heap_bytes_used(),
+       (unsigned) heap_bytes_free());
+}
+
+static void heap_record_deactivate(int app_idx, size_t heap_before) {
+  struct sensismart_heap_stats *stats = &app_states[app_idx].heap;
+  stats->deactivate = (int32_t) (heap_before - heap_bytes_used());
+  stats->held -= stats->deactivate;
+  if (stats->activations == 1)
+    stats->held_first = stats->held;
+  INFO("Heap %s: %d B on deactivate, %d B held (%d B growth), "
+       "%u B peak used, %u B min free", registered_apps[app_idx]->name,
+       (int) stats->deactivate, (int) stats->held,
+       (int) (stats->held - stats->held_first),
+       (unsigned) stats->peak_used, (unsigned) stats->min_free);
+}
+
+static void on_render_timer(void *data) {
+  SensiSmartApp *app = data;
+  render_timer = SCHED_TIMER_NONE;
+  last_render_ms = time_now_ms();
+  if (app->window) {
+    app->render();
+    startup_mark(STARTUP_FIRST_RENDER);
+  }
+  heap_sample(current_app);
+}
+
+void sensismart_request_render(SensiSmartApp *app) {
+  if (!app->render || render_timer)
+    return;
+  if (current_app == -1 || registered_apps[current_app] != app)
+    return;
+
+  uint8_t rate = app->max_frame_rate ? app->max_frame_rate :
+                 DEFAULT_MAX_FRAME_RATE;
+  uint64_t next_frame_ms = last_render_ms + 1000 / rate;
+  uint64_t now = time_now_ms();
+  uint32_t delay = next_frame_ms > now ? next_frame_ms - now : 0;
+  if (delay < RENDER_COALESCE_MS)
+    delay = RENDER_COALESCE_MS;
+  render_timer = sched_register(delay, 0, on_render_timer, app);
+}
+
+static void bitmap_cache_evict(struct bitmap_cache_entry *e) {
+  gbitmap_destroy(e->bitmap);
+  e->bitmap = NULL;
+  bitmap_cache_unused_bytes -= e->size;
+}
+
+/* Least recently used bitmap which is not in use */
+static struct bitmap_cache_entry *bitmap_cache_lru_unused() {
+  struct bitmap_cache_entry *lru = NULL;
+  struct bitmap_cache_entry *e;
+  for (e = bitmap_cache; e < bitmap_cache + BITMAP_CACHE_SIZE; ++e) {
+    if (!e->bitmap || e->refs)
+      continue;
+    if (!lru || (uint16_t) (bitmap_cache_clock - e->last_use) >
+                (uint16_t) (bitmap_cache_clock - lru->last_use))
+      lru = e;
+  }
+  return lru;
+}
+
+GBitmap *sensismart_bitmap_acquire(uint32_t resource_id) {
+  struct bitmap_cache_entry *free_entry = NULL;
+  struct bitmap_cache_entry *e;
+  for (e = bitmap_cache; e < bitmap_cache + BITMAP_CACHE_SIZE; ++e) {
+    if (e->bitmap && e->resource_id == resource_id) {
+      if (e->refs == 0)
+        bitmap_cache_unused_bytes -= e->size;
+      e->refs += 1;
+      e->last_use = ++bitmap_cache_clock;
+      return e->bitmap;
+    }
+    if (!e->bitmap && !free_entry)
+      free_entry = e;
+  }
+  if (!free_entry) {
+    free_entry = bitmap_cache_lru_unused();
+    if (!free_entry) {
+      WARN("Bitmap cache full, loading resource %u uncached",
+           (unsigned) resource_id);
+      return gbitmap_create_with_resource(resource_id);
+    }
+    bitmap_cache_evict(free_entry);
+  }
+
+  GBitmap *bitmap = gbitmap_create_with_resource(resource_id);
+  if (!bitmap)
+    return NULL;
+  *free_entry = (struct bitmap_cache_entry) {
+    .bitmap = bitmap,
+    .resource_id = resource_id,
+    .size = gbitmap_get_bytes_per_row(bitmap) * gbitmap_get_bounds(bitmap).size.h,
+    .refs = 1,
+    .last_use = ++bitmap_cache_clock
+  };
+  return bitmap;
+}
+
+void sensismart_bitmap_release(GBitmap *bitmap) {
+  struct bitmap_cache_entry *e;
+  if (!bitmap)
+    return;
+  for (e = bitmap_cache; e < bitmap_cache + BITMAP_CACHE_SIZE; ++e) {
+    if (e->bitmap != bitmap)
+      continue;
+    if (e->refs == 0 || --e->refs > 0)
+      return;
+    bitmap_cache_unused_bytes += e->size;
+    /* keep the heap flat: large unused bitmaps are not kept */
+    while (bitmap_cache_unused_bytes > BITMAP_CACHE_UNUSED_BUDGET)
+      bitmap_cache_evict(bitmap_cache_lru_unused());
+    return;
+  }
+  /* loaded uncached because the cache was full */
+  gbitmap_destroy(bitmap);
+}
+
+void sensismart_bitmap_trim() {
+  struct bitmap_cache_entry *e;
+  for (e = bitmap_cache; e < bitmap_cache + BITMAP_CACHE_SIZE; ++e) {
+    if (e->bitmap && e->refs == 0)
+      bitmap_cache_evict(e);
+  }
+}
+
+static void on_dialog_update_proc(Layer *layer, GContext *ctx) {
+  GRect rect = layer_get_bounds(layer);
+  graphics_context_set_fill_color(ctx, GColorWhite);
+  graphics_fill_rect(ctx, rect, 0, GCornerNone);
+}
+
+static void dialog_create_disconnect_warning(Dialog *dialog) {
+  dialog->layer = layer_create(GRect(0, 45, DIALOG_WIDTH, DIALOG_HEIGHT));
+
+  dialog->res_icon = sensismart_bitmap_acquire(RESOURCE_ID_IMAGE_CAUTION);
+  dialog->icon_layer = bitmap_layer_create(GRect(5, 5, 46, 50));
+  bitmap_layer_set_bitmap(dialog->icon_layer, dialog->res_icon);
+  layer_add_child(dialog->layer, (Layer *)dialog->icon_layer);
+
+  dialog->text_layer = text_layer_create(GRect(50, 7, 84, 40));
+  text_layer_set_font(dialog->text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18));
+  text_layer_set_text(dialog->text_layer, BACKPACK_DISCONNECTED_TEXT);
+  text_layer_set_text_color(dialog->text_layer, GColorBlack);
+  text_layer_set_background_color(dialog->text_layer, GColorWhite);
+  text_layer_set_text_alignment(dialog->text_layer, GTextAlignmentCenter);
+  layer_add_child(dialog->layer, text_layer_get_layer(dialog->text_layer));
+
+  layer_set_update_proc(dialog->layer, (LayerUpdateProc)on_dialog_update_proc);
+  layer_mark_dirty(dialog->layer);
+}
+
+static void dialog_destroy(Dialog *dialog) {
+  sensismart_bitmap_release(dialog->res_icon);
+  bitmap_layer_destroy(dialog->icon_layer);
+  layer_destroy(dialog->layer);
+  text_layer_destroy(dialog->text_layer);
+}
+
+/* The dialog is shared by all apps and shown on top of the active window */
+static void attach_disconnect_dialog(Window *window) {
+  layer_remove_from_parent(disconnect_dialog.layer);
+  if (!window)
+    return;
+  layer_add_child(window_get_root_layer(window), disconnect_dialog.layer);
+  layer_set_hidden(disconnect_dialog.layer, bp_get_status());
+}
+
+static void on_connection_state_changed(bool connected) {
+  if (connected)
+    startup_mark(STARTUP_CONNECTED);
+  layer_set_hidden(disconnect_dialog.layer, connected);
+}
+
 void sensismart_window_load(SensiSmartApp *app) {
   window_set_background_color(app->window, GColorBlack);
 }
 
 void sensismart_app_init(int apps_len, SensiSmartApp *apps[]) {
-  res_branding_logo = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_LOGO_BLACK);
+  res_branding_logo = sensismart_bitmap_acquire(RESOURCE_ID_IMAGE_LOGO_BLACK);
   branding_layer = bitmap_layer_create(GRect(0, 135, 144, 23));
   bitmap_layer_set_bitmap(branding_layer, res_branding_logo);
+  dialog_create_disconnect_warning(&disconnect_dialog);
+  bp_set_connection_state_observer(on_connection_state_changed);
 
   num_apps = apps_len;
   registered_apps = apps;
   current_app = -1;
-  for (int i = 0; i < num_apps; ++i) {
-    if (apps[i]->load)
-      apps[i]->load();
+  /* the apps are loaded on their first activation */
+  app_states = calloc(num_apps, sizeof(struct app_state));
+}
+
+static void destroy_window(int app_idx) {
+  SensiSmartApp *app = registered_apps[app_idx];
+  DBG("Destroying window of %s (%u B)", app->name,
+      (unsigned) app_states[app_idx].window_heap);
+  size_t heap_before = heap_bytes_used();
+  /* the shared branding layer may have moved on to the shown window */
+  Layer *branding = sensismart_get_branding_layer();
+  if (layer_get_window(branding) == app->window)
+    layer_remove_from_parent(branding);
+  if (app->window_unload)
+    app->window_unload(app->window);
+  sensismart_ui_release(app);
+  window_destroy(app->window);
+  app->window = NULL;
+  app_states[app_idx].window_heap = 0;
+  app_states[app_idx].heap.held -= (int32_t) (heap_before - heap_bytes_used());
+}
+
+static void load_app(int app_idx) {
+  SensiSmartApp *app = registered_apps[app_idx];
+  struct app_state *state = &app_states[app_idx];
+  if (state->loaded)
+    return;
+  state->loaded = true;
+  state->last_active_ms = time_now_ms();
+  if (app->max_ui_objects) {
+    state->ui_objects = malloc(app->max_ui_objects * sizeof(struct ui_object));
+    state->max_ui_objects = state->ui_objects ? app->max_ui_objects : 0;
+    if (!state->ui_objects)
+      ERR("Out of memory for the UI objects of %s", app->name);
   }
+  if (!app->load)
+    return;
+  DBG("Loading %s", app->name);
+  size_t heap_before = heap_bytes_used();
+  app->load();
+  state->heap.load = (int32_t) (heap_bytes_used() - heap_before);
+  state->heap.held += state->heap.load;
+}
+
+static void unload_app(int app_idx) {
+  SensiSmartApp *app = registered_apps[app_idx];
+  struct app_state *state = &app_states[app_idx];
+  if (!state->loaded)
+    return;
+  DBG("Unloading %s", app->name);
+  if (app->window_load && app->window)
+    destroy_window(app_idx);
+  size_t heap_before = heap_bytes_used();
+  if (app->unload)
+    app->unload();
+  sensismart_ui_release(app);
+  free(state->ui_objects);
+  state->ui_objects = NULL;
+  state->max_ui_objects = 0;
+  state->heap.held -= (int32_t) (heap_before - heap_bytes_used());
+  state->loaded = false;
 }
 
 void sensismart_app_deinit() {
+  cancel_render();
+  bp_prefetch_clear();
+  bp_set_connection_state_observer(NULL);
+  attach_disconnect_dialog(NULL);
   for (int i = 0; i < num_apps; ++i) {
-    if (registered_apps[i]->unload)
-      registered_apps[i]->unload();
+    if (registered_apps[i]->window_load && registered_apps[i]->window)
+      destroy_window(i);
   }
+  if (idle_timer) {
+    sched_cancel(idle_timer);
+    idle_timer = SCHED_TIMER_NONE;
+  }
+  for (int i = 0; i < num_apps; ++i)
+    unload_app(i);
+  free(app_states);
 
-  gbitmap_destroy(res_branding_logo);
+  sensismart_bitmap_release(res_branding_logo);
   bitmap_layer_destroy(branding_layer);
+  dialog_destroy(&disconnect_dialog);
+  sensismart_bitmap_trim();
+}
+
+void sensismart_set_window_budget(size_t bytes) {
+  window_budget = bytes;
+}
+
+static void create_window(int app_idx) {
+  SensiSmartApp *app = registered_apps[app_idx];
+  size_t heap_before = heap_bytes_used();
+  app->window = window_create();
+  sensismart_window_load(app);
+  app->window_load(app->window);
+  app_states[app_idx].window_heap = heap_bytes_used() - heap_before;
+  app_states[app_idx].uses_branding =
+      layer_get_window(sensismart_get_branding_layer()) == app->window;
+}
+
+static void show_window(int app_idx) {
+  SensiSmartApp *app = registered_apps[app_idx];
+  if (!app->window)
+    create_window(app_idx);
+  if (app_states[app_idx].uses_branding) {
+    /* the branding layer is shared by all windows */
+    Layer *branding = sensismart_get_branding_layer();
+    layer_remove_from_parent(branding);
+    layer_add_child(window_get_root_layer(app->window), branding);
+  }
+  window_stack_push(app->window, true);
+}
+
+/* Destroy the least recently used inactive windows beyond the budget */
+static void trim_windows() {
+  for (;;) {
+    size_t total = 0;
+    int lru = -1;
+    for (int i = 0; i < num_apps; ++i) {
+      if (i == current_app || !registered_apps[i]->window_load ||
+          !registered_apps[i]->window)
+        continue;
+      total += app_states[i].window_heap;
+      if (lru == -1 || app_states[i].last_used < app_states[lru].last_used)
+        lru = i;
+    }
+    size_t budget = heap_bytes_free() / WINDOW_BUDGET_FREE_DIVISOR;
+    if (budget > window_budget)
+      budget = window_budget;
+    if (lru == -1 || total <= budget)
+      return;
+    destroy_window(lru);
+  }
+}
+
+static bool is_neighbor(int app_idx) {
+  return app_idx == (current_app + 1) % num_apps ||
+         app_idx == (current_app + num_apps - 1) % num_apps;
+}
+
+/*
+ * Keep the channels of the neighboring apps warm
+ * Only loaded apps are prefetched, loading a neighbor just for the prefetch
+ * would allocate e.g. the chart buffers of screens that may never be shown.
+ */
+static void update_prefetch() {
+  bp_prefetch_clear();
+  int neighbors[] = {
+    (current_app + 1) % num_apps,
+    (current_app + num_apps - 1) % num_apps
+  };
+  for (unsigned i = 0; i < ARRAY_LENGTH(neighbors); ++i) {
+    SensiSmartApp *app = registered_apps[neighbors[i]];
+    if (neighbors[i] == current_app || !app->prefetch ||
+        !app_states[neighbors[i]].loaded)
+      continue;
+    app->prefetch();
+  }
+}
+
+void sensismart_set_idle_unload(uint32_t timeout_ms) {
+  idle_unload_ms = timeout_ms;
+}
+
+static void unload_idle_apps();
+
+static void on_idle_timer(void *data) {
+  idle_timer = SCHED_TIMER_NONE;
+  unload_idle_apps();
+}
+
+/* Unload the idle apps and wait for the next one to become idle */
+static void unload_idle_apps() {
+  if (idle_timer) {
+    sched_cancel(idle_timer);
+    idle_timer = SCHED_TIMER_NONE;
+  }
+  if (!idle_unload_ms)
+    return;
+  uint64_t now = time_now_ms();
+  uint64_t next_expiry_ms = 0;
+  for (int i = 0; i < num_apps; ++i) {
+    /* neighbors may be prefetched */
+    if (i == current_app || !app_states[i].loaded || is_neighbor(i))
+      continue;
+    uint64_t expiry_ms = app_states[i].last_active_ms + idle_unload_ms;
+    if (expiry_ms <= now)
+      unload_app(i);
+    else if (!next_expiry_ms || expiry_ms < next_expiry_ms)
+      next_expiry_ms = expiry_ms;
+  }
+  if (next_expiry_ms)
+    idle_timer = sched_register(next_expiry_ms - now, IDLE_UNLOAD_SLACK_MS,
+                                on_idle_timer, NULL);
 }
 
 static void switch_app(int app_idx) {
+  SensiSmartApp *prev = NULL;
   if (current_app != -1) {
     if (num_apps == 1)
       return;
-    registered_apps[current_app]->deactivate();
+    prev = registered_apps[current_app];
+    cancel_render();
+    /* detach before an app destroys its window */
+    attach_disconnect_dialog(NULL);
+    heap_sample(current_app);
+    size_t heap_before = heap_bytes_used();
+    prev->deactivate();
+    heap_record_deactivate(current_app, heap_before);
+    app_states[current_app].last_used = ++app_switch_count;
+    app_states[current_app].last_active_ms = time_now_ms();
   }
   current_app = app_idx;
-  DBG("Switch app: %s", registered_apps[current_app]->name);
-  registered_apps[current_app]->activate();
+  SensiSmartApp *app = registered_apps[current_app];
+  DBG("Switch app: %s", app->name);
+  load_app(current_app);
+  size_t heap_before = heap_bytes_used();
+  if (app->window_load)
+    show_window(current_app);
+  app->activate();
+  attach_disconnect_dialog(app->window);
+  /* remove the previous window below the new one to avoid flicker */
+  if (prev && prev->window_load)
+    window_stack_remove(prev->window, false);
+  heap_record_activate(current_app, heap_before);
+  trim_windows();
+  update_prefetch();
+  unload_idle_apps();
+}
+
+int sensismart_get_num_apps() {
+  return num_apps;
+}
+
+SensiSmartApp *sensismart_get_app(int app_idx) {
+  if (app_idx < 0 || app_idx >= num_apps)
+    return NULL;
+  return registered_apps[app_idx];
+}
+
+const struct sensismart_heap_stats *sensismart_get_heap_stats(int app_idx) {
+  if (app_idx < 0 || app_idx >= num_apps)
+    return NULL;
+  return &app_states[app_idx].heap;
+}
+
+void sensismart_log_heap_stats() {
+  INFO("Heap: %u B used, %u B free", (unsigned) heap_bytes_used(),
+       (unsigned) heap_bytes_free());
+  for (int i = 0; i < num_apps; ++i) {
+    const struct sensismart_heap_stats *stats = &app_states[i].heap;
+    INFO("Heap %s: %u activations, load %d B, activate %d B, "
+         "deactivate %d B, held %d B (%d B growth), %u B peak used, "
+         "%u B min free", registered_apps[i]->name,
+         (unsigned) stats->activations, (int) stats->load,
+         (int) stats->activate, (int) stats->deactivate, (int) stats->held,
+         (int) (stats->held - stats->held_first),
+         (unsigned) stats->peak_used, (unsigned) stats->min_free);
+  }
 }
 
 void sensismart_app_next() {
@@ -109,39 +617,112 @@ void sensismart_setup_controls(SensiSmartApp *app) {
   window_single_click_subscribe(BUTTON_ID_DOWN, on_click_down);
 }
 
-Layer *sensismart_get_branding_layer() {
-  return (Layer *)branding_layer;
+static int app_index(SensiSmartApp *app) {
+  for (int i = 0; i < num_apps; ++i) {
+    if (registered_apps[i] == app)
+      return i;
+  }
+  return -1;
 }
 
-void on_dialog_update_proc(Layer *layer, GContext *ctx) {
-  GRect rect = layer_get_bounds(layer);
-  graphics_context_set_fill_color(ctx, GColorWhite);
-  graphics_fill_rect(ctx, rect, 0, GCornerNone);
+static void ui_destroy(struct ui_object *o) {
+  switch (o->type) {
+  case UI_TEXT_LAYER:
+    text_layer_destroy(o->object);
+    break;
+  case UI_BITMAP_LAYER:
+    bitmap_layer_destroy(o->object);
+    break;
+  case UI_LAYER:
+    layer_destroy(o->object);
+    break;
+  case UI_GPATH:
+    gpath_destroy(o->object);
+    break;
+  }
 }
 
-void dialog_create_disconnect_warning(Dialog *dialog) {
-  dialog->layer = layer_create(GRect(0, 45, DIALOG_WIDTH, DIALOG_HEIGHT));
+/*
+ * Add a UI object to the table of its app. The table is not grown, an object
+ * beyond max_ui_objects is destroyed and NULL returned.
+ */
+static void *ui_track(SensiSmartApp *app, void *object,
+                      enum ui_object_type type) {
+  int app_idx = app_index(app);
+  if (!object || app_idx < 0)
+    return object;
+  struct app_state *state = &app_states[app_idx];
+  struct ui_object o = {
+    .object = object,
+    .type = type
+  };
+  if (state->num_ui_objects == state->max_ui_objects) {
+    ERR("UI objects of %s exceed max_ui_objects (%u)", app->name,
+        (unsigned) app->max_ui_objects);
+    ui_destroy(&o);
+    return NULL;
+  }
+  state->ui_objects[state->num_ui_objects++] = o;
+  return object;
+}
 
-  dialog->res_icon = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_CAUTION);
-  dialog->icon_layer = bitmap_layer_create(GRect(5, 5, 46, 50));
-  bitmap_layer_set_bitmap(dialog->icon_layer, dialog->res_icon);
-  layer_add_child(dialog->layer, (Layer *)dialog->icon_layer);
+TextLayer *sensismart_text_layer_create(SensiSmartApp *app, GRect frame) {
+  return ui_track(app, text_layer_create(frame), UI_TEXT_LAYER);
+}
 
-  dialog->text_layer = text_layer_create(GRect(50, 7, 84, 40));
-  text_layer_set_font(dialog->text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18));
-  text_layer_set_text(dialog->text_layer, BACKPACK_DISCONNECTED_TEXT);
-  text_layer_set_text_color(dialog->text_layer, GColorBlack);
-  text_layer_set_background_color(dialog->text_layer, GColorWhite);
-  text_layer_set_text_alignment(dialog->text_layer, GTextAlignmentCenter);
-  layer_add_child(dialog->layer, text_layer_get_layer(dialog->text_layer));
+BitmapLayer *sensismart_bitmap_layer_create(SensiSmartApp *app, GRect frame) {
+  return ui_track(app, bitmap_layer_create(frame), UI_BITMAP_LAYER);
+}
 
-  layer_set_update_proc(dialog->layer, (LayerUpdateProc)on_dialog_update_proc);
-  layer_mark_dirty(dialog->layer);
+Layer *sensismart_layer_create(SensiSmartApp *app, GRect frame) {
+  return ui_track(app, layer_create(frame), UI_LAYER);
 }
 
-void dialog_destroy(Dialog* dialog) {
-  gbitmap_destroy(dialog->res_icon);
-  bitmap_layer_destroy(dialog->icon_layer);
-  layer_destroy(dialog->layer);
-  text_layer_destroy(dialog->text_layer);
+GPath *sensismart_gpath_create(SensiSmartApp *app, const GPathInfo *info) {
+  return ui_track(app, gpath_create(info), UI_GPATH);
+}
+
+void sensismart_ui_release(SensiSmartApp *app) {
+  int app_idx = app_index(app);
+  if (app_idx < 0)
+    return;
+  struct app_state *state = &app_states[app_idx];
+  while (state->num_ui_objects > 0)
+    ui_destroy(&state->ui_objects[--state->num_ui_objects]);
+}
+
+Layer *sensismart_get_branding_layer() {
+  return (Layer *)branding_layer;
+}
+
+void value_display_init(ValueDisplay *display, TextLayer *layer,
+                        const char *label, const char *unit, int precision) {
+  display->layer = layer;
+  display->unit = unit;
+  display->precision = precision < 0 ? 0 : precision > 3 ? 3 : precision;
+  display->valid = false;
+  /* the label never changes, only the value and unit behind it are written */
+  display->label_len = 0;
+  for (; label && *label && display->label_len < sizeof(display->buf) - 1;
+       ++label)
+    display->buf[display->label_len++] = *label;
+  display->buf[display->label_len] = '\0';
+}
+
+void value_display_set_milli(ValueDisplay *display, int32_t milli) {
+  int32_t quantized = round_milli(milli, display->precision);
+  if (display->valid && display->shown == quantized)
+    return;
+  display->shown = quantized;
+  display->valid = true;
+
+  format_milli(display->buf + display->label_len,
+               sizeof(display->buf) - display->label_len, milli,
+               display->precision, 0, display->unit);
+  text_layer_set_text(display->layer, display->buf);
+}
+
+void value_display_set_text(ValueDisplay *display, const char *text) {
+  display->valid = false;
+  text_layer_set_text(display->layer, text);
 }
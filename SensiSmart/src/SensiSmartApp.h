@@ -41,14 +41,50 @@ typedef struct SensiSmartApp {
   const char *name;
   /** Pointer to the Window (NULL if none) */
   Window *window;
-  /** Mini-app initialization callback (only called once) */
+  /** Mini-app initialization callback, called before the first activation */
   void (*load)();
-  /** Mini-app finalization callback (only called once) */
+  /**
+   * Mini-app finalization callback, called on exit or when the app has been
+   * idle for longer than the idle unload timeout. load is called again
+   * before the next activation.
+   */
   void (*unload)();
   /** Mini-app activation callback */
   void (*activate)();
   /** Mini-app deactivation callback */
   void (*deactivate)();
+  /**
+   * Optional callback to apply the pending updates to the layers, called at
+   * most once per frame after sensismart_request_render()
+   */
+  void (*render)();
+  /** Maximal number of frames per second (0 for the default) */
+  uint8_t max_frame_rate;
+  /**
+   * Optional callback to build the layers of a framework-owned window
+   *
+   * When set, the framework creates the window, calls window_load once and
+   * pushes the window before activate. The window is kept when switching
+   * away and only destroyed (after window_unload) when the heap budget of
+   * inactive windows is exceeded, see sensismart_set_window_budget().
+   * Apps without it create and push their window in activate.
+   */
+  void (*window_load)(Window *window);
+  /** Destroy the layers built by window_load, not the window itself */
+  void (*window_unload)(Window *window);
+  /**
+   * Optional callback to register the backpack channels of the app with
+   * bp_prefetch()/bp_prefetch_attribute(). It is called while the app is
+   * loaded and next to the active one, such that it shows current values on
+   * a switch back to it.
+   */
+  void (*prefetch)();
+  /**
+   * Number of UI objects created with the sensismart_*_create functions,
+   * see sensismart_ui_release(). The table is allocated on load and is a
+   * hard limit, creating more objects fails.
+   */
+  uint8_t max_ui_objects;
 } SensiSmartApp;
 
 /**
@@ -62,16 +98,78 @@ void sensismart_app_init(int apps_len, SensiSmartApp *apps[]);
  */
 void sensismart_app_deinit();
 
+/**
+ * Set the heap kept by the windows of inactive apps, the least recently
+ * used windows are destroyed beyond it (4 KB by default). The budget is
+ * further limited to a quarter of the free heap.
+ */
+void sensismart_set_window_budget(size_t bytes);
+
+/**
+ * Unload apps which have not been active for the given time, except the
+ * active app and its neighbors (0 to disable, the default)
+ * The unload callback drops the state of an app, e.g. the recorded history of
+ * a chart, so only enable it when no screen keeps data across switches.
+ */
+void sensismart_set_idle_unload(uint32_t timeout_ms);
+
+/**
+ * Heap statistics of an app in bytes
+ *
+ * The deltas are measured with heap_bytes_used() around the framework
+ * callbacks, frees completing later (e.g. the unload of an animated window
+ * pop) are attributed to the next measurement.
+ */
+struct sensismart_heap_stats {
+  /** heap allocated by load() */
+  int32_t load;
+  /** heap allocated by the last activation, including the window */
+  int32_t activate;
+  /** heap released by the last deactivate() */
+  int32_t deactivate;
+  /** heap currently attributed to the app */
+  int32_t held;
+  /** held after the first deactivation, a growing difference hints at a leak */
+  int32_t held_first;
+  /** highest heap use while the app was active */
+  uint32_t peak_used;
+  /** lowest free heap while the app was active */
+  uint32_t min_free;
+  uint16_t activations;
+};
+
+/** Number of registered apps */
+int sensismart_get_num_apps();
+
+/** Get a registered app, NULL if out of range */
+SensiSmartApp *sensismart_get_app(int app_idx);
+
+/** Get the heap statistics of a registered app, NULL if out of range */
+const struct sensismart_heap_stats *sensismart_get_heap_stats(int app_idx);
+
+/** Log the heap statistics of all apps */
+void sensismart_log_heap_stats();
+
 /** Switch to the next app */
 void sensismart_app_next();
 
 /** Switch to the previous app */
 void sensismart_app_prev();
 
+/**
+ * Schedule the render callback of the app
+ *
+ * Updates requested before the next frame are coalesced into a single call
+ * of the render callback, which is delayed to respect the max_frame_rate of
+ * the app. Apps without a render callback are ignored.
+ */
+void sensismart_request_render(SensiSmartApp *app);
+
 /**
  * Setup the basic window
  * o set default background color
- * o push window on window stack
+ *
+ * Framework-owned windows are set up before window_load is called.
  */
 void sensismart_window_load(SensiSmartApp *app);
 
@@ -83,6 +181,31 @@ void sensismart_window_load(SensiSmartApp *app);
  */
 void sensismart_setup_controls(SensiSmartApp *app);
 
+/**
+ * UI objects destroyed as a group
+ *
+ * The UI objects of a screen are created through these functions, which
+ * track them in a table allocated at load with max_ui_objects entries, such
+ * that a screen does not need to destroy each of its layers itself. The table
+ * is not grown: an object beyond max_ui_objects is logged as an error,
+ * destroyed and NULL is returned. The objects themselves are allocated by the
+ * SDK, which offers no way to place them in memory of the app, so they are
+ * interleaved with other allocations such as bitmaps.
+ *
+ * Framework-owned windows release their objects after window_unload when the
+ * window is destroyed. Inactive windows are kept within the window budget, a
+ * budget of 0 releases them on every switch, see
+ * sensismart_set_window_budget(). Apps with their own window call
+ * sensismart_ui_release() from their window unload handler.
+ */
+TextLayer *sensismart_text_layer_create(SensiSmartApp *app, GRect frame);
+BitmapLayer *sensismart_bitmap_layer_create(SensiSmartApp *app, GRect frame);
+Layer *sensismart_layer_create(SensiSmartApp *app, GRect frame);
+GPath *sensismart_gpath_create(SensiSmartApp *app, const GPathInfo *info);
+
+/** Destroy all tracked UI objects of an app, newest first */
+void sensismart_ui_release(SensiSmartApp *app);
+
 /**
  * Retrieve the layer containing the branding (logo)
  * It is the caller's responsability to add the layer to the window but it must
@@ -90,23 +213,57 @@ void sensismart_setup_controls(SensiSmartApp *app);
  */
 Layer *sensismart_get_branding_layer();
 
-typedef struct Dialog {
-  Layer *layer;
-  GBitmap *res_icon;
-  BitmapLayer *icon_layer;
-  TextLayer *text_layer;
-} Dialog;
+/**
+ * Get a shared bitmap of an image resource
+ *
+ * Bitmaps are reference counted and stay cached after their last release,
+ * such that switching screens doesn't reload the images. Unused bitmaps are
+ * evicted when the cache is full or by sensismart_bitmap_trim().
+ *
+ * @return the bitmap or NULL if it could not be loaded
+ */
+GBitmap *sensismart_bitmap_acquire(uint32_t resource_id);
+
+/** Release a bitmap returned by sensismart_bitmap_acquire, NULL is ignored */
+void sensismart_bitmap_release(GBitmap *bitmap);
+
+/** Free all cached bitmaps which are not in use */
+void sensismart_bitmap_trim();
 
 /**
- * Create a backpack disconnected warning dialog
+ * Text layer bound to a numeric value
+ *
+ * The value is quantized to the display precision and the text is only
+ * reformatted and the layer only marked dirty when the quantized value
+ * changes, so steady readings cause no redraws.
  */
-void dialog_create_disconnect_warning(Dialog *dialog);
+typedef struct ValueDisplay {
+  TextLayer *layer;
+  /** Unit appended to the value, e.g. " °C" (NULL for none) */
+  const char *unit;
+  /** Length of the label kept at the start of buf */
+  size_t label_len;
+  /** Number of decimals shown, 0 to 3 */
+  int precision;
+  /** Value shown in units of the display precision */
+  int32_t shown;
+  bool valid;
+  char buf[32];
+} ValueDisplay;
 
 /**
- * Free a dialog
+ * Bind a value display to a text layer, nothing is shown until a value is set
+ * The text is the label, the value and the unit, e.g. "T: " "21.50" " °C".
+ * Label and unit may be NULL.
  */
-void dialog_destroy(Dialog *dialog);
+void value_display_init(ValueDisplay *display, TextLayer *layer,
+                        const char *label, const char *unit, int precision);
+
+/** Show a fixed point value in milli-units */
+void value_display_set_milli(ValueDisplay *display, int32_t milli);
 
+/** Show a text instead of a value, e.g. a placeholder while disconnected */
+void value_display_set_text(ValueDisplay *display, const char *text);
 
 #endif /* SENSI_SMART_APP_H */
 
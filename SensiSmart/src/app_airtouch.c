@@ -33,6 +33,7 @@
 #include <pebble.h>
 #include "backpack.h"
 #include "SensiSmartApp.h"
+#include "scheduler.h"
 #include "utils.h"
 #include "app_airtouch.h"
 
@@ -42,6 +43,9 @@ static const char *PRESENTS_TEXT = "presents";
 static const char *DISMISS_TEXT = "to dismiss\nnotifications";
 
 static const int TOAST_TIMEOUT_MS = 2000;
+static const uint32_t TOAST_SLACK_MS = 250;
+/** The notification events are random, they may run late */
+static const uint32_t EVENT_TIME_SLACK_MS = 1000;
 
 enum event_time_range {
   RANGE_SECONDS,
@@ -58,11 +62,11 @@ static struct {
   TextLayer *airtouch_text_layer;
   TextLayer *time_layer;
   char time_buf[9];
-  AppTimer *notification_event_timer;
+  SchedTimer notification_event_timer;
   bool notification_active;
   int notification_range_idx;
   TextLayer *toast_text_layer;
-  AppTimer *toast_show_timer;
+  SchedTimer toast_show_timer;
   char toast_text_layer_buf[60];
   GBitmap *res_bmp_logo_black;
   GBitmap *res_bmp_logo_white;
@@ -73,7 +77,6 @@ static struct {
   TextLayer *dismiss_text_layer;
   BitmapLayer *top_bar_layer;
   BitmapLayer *bottom_bar_layer;
-  Dialog dialog;
 } app;
 
 static void update_clock() {
@@ -104,10 +107,6 @@ static void update_display() {
   layer_set_hidden(bitmap_layer_get_layer(app.bottom_bar_layer), !app.notification_active);
 }
 
-static void on_connection_state_changed(bool connected) {
-  layer_set_hidden(app.dialog.layer, connected);
-}
-
 static void hide_toast() {
   layer_set_hidden((Layer *)app.toast_text_layer, true);
 
@@ -129,9 +128,10 @@ static void schedule_notification_timer() {
   INFO("Scheduling next Notification Event in %d ms", event_time_ms);
 
   if (!app.notification_event_timer ||
-      !app_timer_reschedule(app.notification_event_timer, event_time_ms)) {
-    app.notification_event_timer = app_timer_register(event_time_ms,
-                                                      show_notification, NULL);
+      !sched_reschedule(app.notification_event_timer, event_time_ms)) {
+    app.notification_event_timer = sched_register(event_time_ms,
+                                                  EVENT_TIME_SLACK_MS,
+                                                  show_notification, NULL);
   }
 }
 
@@ -144,8 +144,9 @@ static void show_toast(const char *message) {
   layer_set_hidden((Layer *)app.toast_text_layer, false);
 
   if (!app.toast_show_timer ||
-      !app_timer_reschedule(app.toast_show_timer, TOAST_TIMEOUT_MS)) {
-    app.toast_show_timer = app_timer_register(TOAST_TIMEOUT_MS, hide_toast, NULL);
+      !sched_reschedule(app.toast_show_timer, TOAST_TIMEOUT_MS)) {
+    app.toast_show_timer = sched_register(TOAST_TIMEOUT_MS, TOAST_SLACK_MS,
+                                          hide_toast, NULL);
   }
 }
 
@@ -178,7 +179,8 @@ static void on_load_window(Window *window) {
   GFont big_font = fonts_get_system_font(FONT_KEY_GOTHIC_28_BOLD);
 
   // app.airtouch_text_layer
-  app.airtouch_text_layer = text_layer_create(GRect(0, 0, 144, 20));
+  app.airtouch_text_layer = sensismart_text_layer_create(&AppAirtouch,
+                                                         GRect(0, 0, 144, 20));
   Layer *airtouch_text_layer = text_layer_get_layer(app.airtouch_text_layer);
   text_layer_set_background_color(app.airtouch_text_layer, GColorClear);
   text_layer_set_text_color(app.airtouch_text_layer, GColorWhite);
@@ -188,7 +190,8 @@ static void on_load_window(Window *window) {
   layer_add_child(root_layer, airtouch_text_layer);
 
   // app.time_layer
-  app.time_layer = text_layer_create(GRect(0, 53, 144, 38));
+  app.time_layer = sensismart_text_layer_create(&AppAirtouch,
+                                                GRect(0, 53, 144, 38));
   text_layer_set_background_color(app.time_layer, GColorClear);
   text_layer_set_text_color(app.time_layer, GColorWhite);
   text_layer_set_text_alignment(app.time_layer, GTextAlignmentCenter);
@@ -196,7 +199,8 @@ static void on_load_window(Window *window) {
   layer_add_child(root_layer, (Layer *)app.time_layer);
 
   // app.toast_text_layer
-  app.toast_text_layer = text_layer_create(GRect(14, 52, 117, 48));
+  app.toast_text_layer = sensismart_text_layer_create(&AppAirtouch,
+                                                      GRect(14, 52, 117, 48));
   text_layer_set_text(app.toast_text_layer, CONFIG_CHANGE_TEXT);
   text_layer_set_font(app.toast_text_layer, toast_font);
   text_layer_set_text_alignment(app.toast_text_layer, GTextAlignmentCenter);
@@ -204,23 +208,26 @@ static void on_load_window(Window *window) {
   layer_set_hidden((Layer *)app.toast_text_layer, true);
 
   // logo bitmaps
-  app.res_bmp_logo_black = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_LOGO_BLACK);
-  app.res_bmp_logo_white = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_LOGO_WHITE);
+  app.res_bmp_logo_black = sensismart_bitmap_acquire(RESOURCE_ID_IMAGE_LOGO_BLACK);
+  app.res_bmp_logo_white = sensismart_bitmap_acquire(RESOURCE_ID_IMAGE_LOGO_WHITE);
 
   // bmp_logo_black_layer
-  app.bmp_logo_black_layer = bitmap_layer_create(GRect(0, 135, 144, 23));
+  app.bmp_logo_black_layer = sensismart_bitmap_layer_create(&AppAirtouch,
+                                                            GRect(0, 135, 144, 23));
   bitmap_layer_set_bitmap(app.bmp_logo_black_layer, app.res_bmp_logo_black);
   layer_add_child(root_layer, (Layer *)app.bmp_logo_black_layer);
 
   // Notification Layers
   // bmp_logo_white_layer
-  app.bmp_logo_white_layer = bitmap_layer_create(GRect(5, 30, 131, 23));
+  app.bmp_logo_white_layer = sensismart_bitmap_layer_create(&AppAirtouch,
+                                                            GRect(5, 30, 131, 23));
   bitmap_layer_set_bitmap(app.bmp_logo_white_layer, app.res_bmp_logo_white);
   layer_add_child(root_layer, (Layer *)app.bmp_logo_white_layer);
   layer_set_hidden((Layer *)app.bmp_logo_white_layer, true);
 
   // airtouch_big_text_layer
-  app.airtouch_big_text_layer = text_layer_create(GRect(0, 73, 144, 28));
+  app.airtouch_big_text_layer = sensismart_text_layer_create(&AppAirtouch,
+                                                             GRect(0, 73, 144, 28));
   text_layer_set_text(app.airtouch_big_text_layer, AIRTOUCH_TEXT);
   text_layer_set_text_alignment(app.airtouch_big_text_layer, GTextAlignmentCenter);
   text_layer_set_font(app.airtouch_big_text_layer, big_font);
@@ -228,7 +235,8 @@ static void on_load_window(Window *window) {
   layer_set_hidden((Layer *)app.airtouch_big_text_layer, true);
 
   // presents_text_layer
-  app.presents_text_layer = text_layer_create(GRect(0, 57, 144, 20));
+  app.presents_text_layer = sensismart_text_layer_create(&AppAirtouch,
+                                                         GRect(0, 57, 144, 20));
   text_layer_set_text(app.presents_text_layer, PRESENTS_TEXT);
   text_layer_set_font(app.presents_text_layer, toast_font);
   text_layer_set_text_alignment(app.presents_text_layer, GTextAlignmentCenter);
@@ -236,7 +244,8 @@ static void on_load_window(Window *window) {
   layer_set_hidden((Layer *)app.presents_text_layer, true);
 
   // dismiss_text_layer
-  app.dismiss_text_layer = text_layer_create(GRect(0, 100, 144, 42));
+  app.dismiss_text_layer = sensismart_text_layer_create(&AppAirtouch,
+                                                        GRect(0, 100, 144, 42));
   text_layer_set_text(app.dismiss_text_layer, DISMISS_TEXT);
   text_layer_set_font(app.dismiss_text_layer, text_font);
   text_layer_set_text_alignment(app.dismiss_text_layer, GTextAlignmentCenter);
@@ -244,12 +253,14 @@ static void on_load_window(Window *window) {
   layer_set_hidden((Layer *)app.dismiss_text_layer, true);
 
   // notificatoin bars
-  app.top_bar_layer = bitmap_layer_create(GRect(0, 0, 144, 20));
+  app.top_bar_layer = sensismart_bitmap_layer_create(&AppAirtouch,
+                                                     GRect(0, 0, 144, 20));
   bitmap_layer_set_background_color(app.top_bar_layer, GColorBlack);
   layer_add_child(root_layer, (Layer *)app.top_bar_layer);
   layer_set_hidden((Layer *)app.top_bar_layer, true);
 
-  app.bottom_bar_layer = bitmap_layer_create(GRect(0, 148, 144, 20));
+  app.bottom_bar_layer = sensismart_bitmap_layer_create(&AppAirtouch,
+                                                        GRect(0, 148, 144, 20));
   bitmap_layer_set_background_color(app.bottom_bar_layer, GColorBlack);
   layer_add_child(root_layer, (Layer *)app.bottom_bar_layer);
   layer_set_hidden((Layer *)app.bottom_bar_layer, true);
@@ -257,28 +268,13 @@ static void on_load_window(Window *window) {
   // Show notification on start
   app.notification_active = true;
 
-  // Dialog Box for Disconnect Events
-  dialog_create_disconnect_warning(&app.dialog);
-  layer_add_child(root_layer, app.dialog.layer);
-  layer_set_hidden(app.dialog.layer, bp_get_status());
-
   update_display();
 }
 
 static void on_unload_window(Window *window) {
-  text_layer_destroy(app.airtouch_text_layer);
-  text_layer_destroy(app.time_layer);
-  text_layer_destroy(app.toast_text_layer);
-  text_layer_destroy(app.presents_text_layer);
-  text_layer_destroy(app.airtouch_big_text_layer);
-  text_layer_destroy(app.dismiss_text_layer);
-  gbitmap_destroy(app.res_bmp_logo_black);
-  gbitmap_destroy(app.res_bmp_logo_white);
-  bitmap_layer_destroy(app.bmp_logo_black_layer);
-  bitmap_layer_destroy(app.bmp_logo_white_layer);
-  bitmap_layer_destroy(app.top_bar_layer);
-  bitmap_layer_destroy(app.bottom_bar_layer);
-  dialog_destroy(&app.dialog);
+  sensismart_ui_release(&AppAirtouch);
+  sensismart_bitmap_release(app.res_bmp_logo_black);
+  sensismart_bitmap_release(app.res_bmp_logo_white);
   window_destroy(app.window);
 }
 
@@ -300,7 +296,6 @@ static void activate() {
   });
   window_set_click_config_provider(app.window, (ClickConfigProvider) click_config_provider);
   bp_subscribe((BackpackHandlers) {
-    .on_connection_state_changed = on_connection_state_changed,
     .on_airtouch_event = on_airtouch,
   });
   window_stack_push(app.window, true);
@@ -311,12 +306,12 @@ static void activate() {
 
 static void deactivate() {
   if (app.notification_event_timer) {
-    app_timer_cancel(app.notification_event_timer);
-    app.notification_event_timer = NULL;
+    sched_cancel(app.notification_event_timer);
+    app.notification_event_timer = SCHED_TIMER_NONE;
   }
   if (app.toast_show_timer) {
-    app_timer_cancel(app.toast_show_timer);
-    app.toast_show_timer = NULL;
+    sched_cancel(app.toast_show_timer);
+    app.toast_show_timer = SCHED_TIMER_NONE;
   }
   window_stack_pop(true);
   bp_unsubscribe();
@@ -328,6 +323,7 @@ SensiSmartApp AppAirtouch = {
   .name = "Airtouch",
   .window = NULL,
   .activate = activate,
-  .deactivate = deactivate
+  .deactivate = deactivate,
+  .max_ui_objects = 10
 };
 
@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2016, Sensirion AG
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Sensirion AG nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pebble.h>
+#include "backpack.h"
+#include "SensiSmartApp.h"
+#include "scheduler.h"
+#include "utils.h"
+#include "chart.h"
+#include "app_channel_chart.h"
+
+#define LONG_PRESS_INTERVAL 1000
+
+static const int POLLING_INTERVAL_MS = 2000;
+static const int CHART_HEIGHT = 125;
+static const int CHART_WIDTH = 144;
+
+/** Description of a chartable backpack value */
+struct channel {
+  const char *desc;
+  SmartstrapServiceId service;
+  uint16_t flag;
+  /** sensor readings are int32 milli-units, processed values are floats */
+  bool is_float;
+  /** label and unit shown around the current value */
+  const char *label;
+  const char *unit;
+  int precision;
+  struct chart_config chart_config;
+};
+
+static const struct chart_range TEMPERATURE_RANGES[] = {
+  { .desc = "15 - 40 °C", .min = 15000, .max = 40000 },
+  { .desc = "-10 - 50 °C", .min = -10000, .max = 50000 }
+};
+
+static const struct chart_range HUMIDITY_RANGES[] = {
+  { .desc = "0 - 100 %", .min = 0, .max = 100000 }
+};
+
+static const struct chart_range HUMIDEX_RANGES[] = {
+  { .desc = "15 - 55", .min = 15000, .max = 55000 }
+};
+
+#define TEMPERATURE_CHART_CONFIG(c) { \
+  .ranges = TEMPERATURE_RANGES, \
+  .num_ranges = ARRAY_LENGTH(TEMPERATURE_RANGES), \
+  .default_min = 15000, \
+  .default_max = 40000, \
+  .auto_margin = 500, \
+  .allow_negative = true, \
+  .color = {c} \
+}
+
+static const struct channel CHANNEL_AMBIENT_TEMPERATURE = {
+  .desc = "T",
+  .service = SERVICE_SENSOR_READINGS,
+  .flag = ATTR_SENSOR_READINGS_TEMPERATURE,
+  .label = "T: ",
+  .unit = " °C",
+  .precision = 2,
+  .chart_config = TEMPERATURE_CHART_CONFIG(GColorGreenARGB8)
+};
+
+static const struct channel CHANNEL_AMBIENT_HUMIDITY = {
+  .desc = "RH",
+  .service = SERVICE_SENSOR_READINGS,
+  .flag = ATTR_SENSOR_READINGS_HUMIDITY,
+  .label = "RH: ",
+  .unit = " %",
+  .precision = 1,
+  .chart_config = {
+    .ranges = HUMIDITY_RANGES,
+    .num_ranges = ARRAY_LENGTH(HUMIDITY_RANGES),
+    .default_min = 0,
+    .default_max = 100000,
+    .auto_margin = 2000,
+    .allow_negative = false,
+    .color = {GColorPictonBlueARGB8}
+  }
+};
+
+static const struct channel CHANNEL_SKIN_TEMPERATURE = {
+  .desc = "Skin T",
+  .service = SERVICE_SENSOR_READINGS,
+  .flag = ATTR_SENSOR_READINGS_SKIN_TEMPERATURE,
+  .label = "Skin T: ",
+  .unit = " °C",
+  .precision = 2,
+  .chart_config = TEMPERATURE_CHART_CONFIG(GColorOrangeARGB8)
+};
+
+static const struct channel CHANNEL_FEELLIKE_TEMPERATURE = {
+  .desc = "Feels like",
+  .service = SERVICE_PROCESSED_VALUES,
+  .flag = ATTR_PROCESSED_VALUES_FEELLIKE_TEMPERATURE,
+  .is_float = true,
+  .label = "Feels like: ",
+  .unit = " °C",
+  .precision = 1,
+  .chart_config = TEMPERATURE_CHART_CONFIG(GColorYellowARGB8)
+};
+
+static const struct channel CHANNEL_HUMIDEX = {
+  .desc = "Humidex",
+  .service = SERVICE_PROCESSED_VALUES,
+  .flag = ATTR_PROCESSED_VALUES_HUMIDEX,
+  .is_float = true,
+  .label = "Humidex: ",
+  .precision = 1,
+  .chart_config = {
+    .ranges = HUMIDEX_RANGES,
+    .num_ranges = ARRAY_LENGTH(HUMIDEX_RANGES),
+    .default_min = 15000,
+    .default_max = 55000,
+    .auto_margin = 500,
+    .allow_negative = true,
+    .color = {GColorRedARGB8}
+  }
+};
+
+/** State of a channel chart screen */
+struct channel_chart {
+  const struct channel *channel;
+  SensiSmartApp *app;
+  Chart *chart;
+  TextLayer *current_value_layer;
+  ValueDisplay current_value_display;
+  struct BackpackAttribute attribute;
+  /** latest value, shown by render() */
+  int32_t value;
+  /** false until a value is read and after a disconnect */
+  bool has_value;
+};
+
+static void on_value(struct channel_chart *cc, const uint8_t *data,
+                     size_t length) {
+  int offset = 0;
+  int32_t value;
+  if (cc->channel->is_float) {
+    if (!bp_readval_milli(data, length, &offset, &value, cc->channel->desc))
+      return;
+  } else {
+    if (!bp_readval(data, length, &offset, &value, sizeof(int32_t),
+                    cc->channel->desc))
+      return;
+  }
+  /* a replayed value was sampled earlier and is only shown */
+  if (!bp_get_value_age_ms())
+    chart_add_value(cc->chart, value);
+  cc->value = value;
+  cc->has_value = true;
+  sensismart_request_render(cc->app);
+}
+
+static void on_connection_state_changed(struct channel_chart *cc,
+                                        bool connected) {
+  if (connected)
+    return;
+  cc->has_value = false;
+  sensismart_request_render(cc->app);
+}
+
+static void render(struct channel_chart *cc) {
+  if (cc->has_value)
+    value_display_set_milli(&cc->current_value_display, cc->value);
+  else
+    value_display_set_text(&cc->current_value_display, cc->channel->desc);
+  chart_render(cc->chart);
+}
+
+static void click_config_provider(void *context);
+
+static void on_load_window(struct channel_chart *cc, Window *window) {
+  window_set_click_config_provider_with_context(window, click_config_provider, cc);
+  Layer *root_layer = window_get_root_layer(window);
+
+  chart_attach(cc->chart, root_layer);
+
+  cc->current_value_layer = sensismart_text_layer_create(cc->app,
+                                                         GRect(0, 0, 144, 20));
+  text_layer_set_font(cc->current_value_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18));
+  text_layer_set_text_color(cc->current_value_layer, GColorWhite);
+  text_layer_set_background_color(cc->current_value_layer, GColorClear);
+  text_layer_set_text_alignment(cc->current_value_layer, GTextAlignmentCenter);
+  text_layer_set_text(cc->current_value_layer, cc->channel->desc);
+  value_display_init(&cc->current_value_display, cc->current_value_layer,
+                     cc->channel->label, cc->channel->unit,
+                     cc->channel->precision);
+  layer_add_child(root_layer, text_layer_get_layer(cc->current_value_layer));
+
+  // Sensirion Logo
+  layer_add_child(root_layer, sensismart_get_branding_layer());
+}
+
+static void on_unload_window(struct channel_chart *cc, Window *window) {
+  chart_detach(cc->chart);
+  cc->current_value_layer = NULL;
+}
+
+static void on_short_click_select(ClickRecognizerRef recognizer, void *context) {
+  chart_next_range(((struct channel_chart *) context)->chart);
+}
+
+static void on_long_click_up(ClickRecognizerRef recognizer, void *context) {
+  chart_next_view(((struct channel_chart *) context)->chart);
+}
+
+static void on_long_click_select(ClickRecognizerRef recognizer, void *context) {
+  chart_reset(((struct channel_chart *) context)->chart);
+}
+
+static void click_config_provider(void *context) {
+  struct channel_chart *cc = context;
+  sensismart_setup_controls(cc->app);
+  window_single_click_subscribe(BUTTON_ID_SELECT, on_short_click_select);
+  window_long_click_subscribe(BUTTON_ID_SELECT, LONG_PRESS_INTERVAL,
+                              on_long_click_select, NULL);
+  /* a multi click on select would delay every range change */
+  window_long_click_subscribe(BUTTON_ID_UP, LONG_PRESS_INTERVAL,
+                              on_long_click_up, NULL);
+}
+
+static void activate(struct channel_chart *cc,
+                     ConnectionStateHandler on_connection_state_changed) {
+  bp_set_polling_interval(POLLING_INTERVAL_MS);
+  bp_subscribe_attribute(&cc->attribute);
+  bp_subscribe((BackpackHandlers) {
+    .on_connection_state_changed = on_connection_state_changed
+  });
+}
+
+static void prefetch(struct channel_chart *cc) {
+  bp_prefetch_attribute(&cc->attribute);
+}
+
+static void deactivate(struct channel_chart *cc) {
+  bp_unsubscribe();
+}
+
+static void load(struct channel_chart *cc, BackpackAttributeHandler handler) {
+  const struct channel *channel = cc->channel;
+  cc->chart = chart_create(&channel->chart_config,
+                           GRect(0, 0, CHART_WIDTH, CHART_HEIGHT));
+  bp_init_attribute(&cc->attribute, channel->service, channel->flag,
+                    channel->is_float ? sizeof(float) : sizeof(int32_t),
+                    channel->desc, handler);
+}
+
+static void cleanup_attribute(void *ctx) {
+  struct channel_chart *cc = ctx;
+  if (!bp_destroy_attribute(&cc->attribute)) {
+    INFO("Waiting to clean attribute...");
+    sched_register(DESTROY_RETRY_INTERVAL_MS, 0, cleanup_attribute, ctx);
+  }
+}
+
+static void unload(struct channel_chart *cc) {
+  chart_destroy(cc->chart);
+  cleanup_attribute(cc);
+}
+
+/**
+ * Define a chart screen for a channel
+ *
+ * The SensiSmartApp callbacks have no context, so thin wrappers are
+ * generated for each screen.
+ */
+#define CHANNEL_CHART_APP(app_name, app_channel) \
+  static struct channel_chart app_name##_state = { \
+    .channel = &app_channel, \
+    .app = &app_name \
+  }; \
+  static void app_name##_on_value(const uint8_t *data, size_t length, \
+                                  SmartstrapAttributeId id) { \
+    on_value(&app_name##_state, data, length); \
+  } \
+  static void app_name##_on_connection_state_changed(bool connected) { \
+    on_connection_state_changed(&app_name##_state, connected); \
+  } \
+  static void app_name##_activate() { \
+    activate(&app_name##_state, app_name##_on_connection_state_changed); \
+  } \
+  static void app_name##_deactivate() { \
+    deactivate(&app_name##_state); \
+  } \
+  static void app_name##_prefetch() { \
+    prefetch(&app_name##_state); \
+  } \
+  static void app_name##_load() { \
+    load(&app_name##_state, app_name##_on_value); \
+  } \
+  static void app_name##_unload() { \
+    unload(&app_name##_state); \
+  } \
+  static void app_name##_render() { \
+    render(&app_name##_state); \
+  } \
+  static void app_name##_window_load(Window *window) { \
+    on_load_window(&app_name##_state, window); \
+  } \
+  static void app_name##_window_unload(Window *window) { \
+    on_unload_window(&app_name##_state, window); \
+  } \
+  SensiSmartApp app_name = { \
+    .name = #app_name, \
+    .window = NULL, \
+    .activate = app_name##_activate, \
+    .deactivate = app_name##_deactivate, \
+    .render = app_name##_render, \
+    .load = app_name##_load, \
+    .unload = app_name##_unload, \
+    .window_load = app_name##_window_load, \
+    .window_unload = app_name##_window_unload, \
+    .prefetch = app_name##_prefetch, \
+    .max_ui_objects = 1 \
+  }
+
+CHANNEL_CHART_APP(AppChartAmbientTemperature, CHANNEL_AMBIENT_TEMPERATURE);
+CHANNEL_CHART_APP(AppChartAmbientHumidity, CHANNEL_AMBIENT_HUMIDITY);
+CHANNEL_CHART_APP(AppChartSkinTemperature, CHANNEL_SKIN_TEMPERATURE);
+CHANNEL_CHART_APP(AppChartFeellike, CHANNEL_FEELLIKE_TEMPERATURE);
+CHANNEL_CHART_APP(AppChartHumidex, CHANNEL_HUMIDEX);
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2016, Sensirion AG
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Sensirion AG nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pebble.h>
+#include "backpack.h"
+#include "SensiSmartApp.h"
+#include "utils.h"
+#include "log_export.h"
+#include "app_export.h"
+
+#define LONG_PRESS_INTERVAL_MS 1000
+
+static const char *EXPORT_TITLE = "Export";
+static const char *EXPORT_IDLE_TEXT = "Press: export\nHold: session";
+static const char *EXPORT_RUNNING_TEXT = "Press to cancel";
+static const char *EXPORT_DONE_TEXT = "Export finished";
+static const char *EXPORT_FAILED_TEXT = "Export failed";
+
+static struct {
+  Window *window;
+  TextLayer *title_layer;
+  TextLayer *session_text_layer;
+  TextLayer *progress_text_layer;
+  char session_text_buf[48];
+  char progress_text_buf[64];
+  /** selected session, -1 for the whole log */
+  int session_idx;
+  const char *status_text;
+} app;
+
+static void click_config_provider(Window *window);
+
+static void update_session_text() {
+  const struct bp_log_session *session = bp_log_get_session(app.session_idx);
+  if (app.session_idx < 0 || !session) {
+    snprintf(app.session_text_buf, sizeof(app.session_text_buf),
+             "All sessions (%d)", bp_log_get_num_sessions());
+  } else {
+    struct tm *start = localtime((time_t *) &session->start_time);
+    uint32_t duration_s = (uint64_t) session->num_entries *
+                          session->log_interval_ms / 1000;
+    snprintf(app.session_text_buf, sizeof(app.session_text_buf),
+             "Session #%d\n%02d.%02d. %02d:%02d, %u min",
+             app.session_idx + 1, start->tm_mday, start->tm_mon + 1,
+             start->tm_hour, start->tm_min, (unsigned) (duration_s / 60));
+  }
+  text_layer_set_text(app.session_text_layer, app.session_text_buf);
+}
+
+static void update_progress_text() {
+  const struct log_export_stats *stats = log_export_get_stats();
+  uint32_t rate = stats->duration_ms ?
+                  (uint64_t) stats->bytes * 1000 / stats->duration_ms : 0;
+  snprintf(app.progress_text_buf, sizeof(app.progress_text_buf),
+           "%s\n%u samples\n%u B/s", app.status_text,
+           (unsigned) stats->samples, (unsigned) rate);
+  text_layer_set_text(app.progress_text_layer, app.progress_text_buf);
+}
+
+static void on_export_event(enum log_export_event event) {
+  switch (event) {
+  case LOG_EXPORT_PROGRESS:
+    app.status_text = EXPORT_RUNNING_TEXT;
+    break;
+  case LOG_EXPORT_FINISHED:
+    app.status_text = EXPORT_DONE_TEXT;
+    break;
+  case LOG_EXPORT_FAILED:
+    app.status_text = EXPORT_FAILED_TEXT;
+    break;
+  }
+  /* the export continues in the background when the screen is left */
+  if (app.window)
+    update_progress_text();
+}
+
+static void on_load_window(Window *window) {
+  app.window = window;
+  window_set_click_config_provider(window, (ClickConfigProvider) click_config_provider);
+  Layer *root_layer = window_get_root_layer(window);
+
+  // Screen Title
+  app.title_layer = sensismart_text_layer_create(&AppExport, GRect(0, 0, 144, 30));
+  text_layer_set_font(app.title_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18));
+  text_layer_set_text(app.title_layer, EXPORT_TITLE);
+  text_layer_set_text_color(app.title_layer, GColorWhite);
+  text_layer_set_background_color(app.title_layer, GColorBlack);
+  text_layer_set_text_alignment(app.title_layer, GTextAlignmentCenter);
+  layer_add_child(root_layer, text_layer_get_layer(app.title_layer));
+
+  // Session Summary
+  app.session_text_layer = sensismart_text_layer_create(&AppExport, GRect(0, 25, 144, 40));
+  text_layer_set_font(app.session_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18));
+  text_layer_set_text_color(app.session_text_layer, GColorWhite);
+  text_layer_set_background_color(app.session_text_layer, GColorBlack);
+  text_layer_set_text_alignment(app.session_text_layer, GTextAlignmentCenter);
+  text_layer_set_overflow_mode(app.session_text_layer, GTextOverflowModeWordWrap);
+  layer_add_child(root_layer, text_layer_get_layer(app.session_text_layer));
+
+  // Export Progress
+  app.progress_text_layer = sensismart_text_layer_create(&AppExport, GRect(0, 65, 144, 65));
+  text_layer_set_font(app.progress_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18));
+  text_layer_set_text_color(app.progress_text_layer, GColorBrightGreen);
+  text_layer_set_background_color(app.progress_text_layer, GColorBlack);
+  text_layer_set_text_alignment(app.progress_text_layer, GTextAlignmentCenter);
+  text_layer_set_overflow_mode(app.progress_text_layer, GTextOverflowModeWordWrap);
+  layer_add_child(root_layer, text_layer_get_layer(app.progress_text_layer));
+
+  // Sensirion Logo
+  layer_add_child(root_layer, sensismart_get_branding_layer());
+}
+
+static void on_unload_window(Window *window) {
+  app.window = NULL;
+}
+
+static void on_click_select(ClickRecognizerRef recognizer, void *context) {
+  if (log_export_active()) {
+    log_export_cancel();
+    app.status_text = EXPORT_IDLE_TEXT;
+  } else if (bp_get_status() && log_export_start(app.session_idx, on_export_event)) {
+    app.status_text = EXPORT_RUNNING_TEXT;
+  } else {
+    app.status_text = EXPORT_FAILED_TEXT;
+  }
+  update_progress_text();
+}
+
+static void on_long_click_select(ClickRecognizerRef recognizer, void *context) {
+  /* the session of a running export cannot be changed */
+  if (log_export_active())
+    return;
+  /* cycle through all sessions and the whole log */
+  app.session_idx += 1;
+  if (app.session_idx >= bp_log_get_num_sessions())
+    app.session_idx = -1;
+  update_session_text();
+}
+
+static void click_config_provider(Window *window) {
+  sensismart_setup_controls(&AppExport);
+  /* a hold only triggers the long click, never the single click */
+  window_single_click_subscribe(BUTTON_ID_SELECT, on_click_select);
+  window_long_click_subscribe(BUTTON_ID_SELECT, LONG_PRESS_INTERVAL_MS,
+                              on_long_click_select, NULL);
+}
+
+static void activate() {
+  if (app.session_idx >= bp_log_get_num_sessions())
+    app.session_idx = -1;
+  update_session_text();
+  if (!log_export_active())
+    app.status_text = EXPORT_IDLE_TEXT;
+  update_progress_text();
+}
+
+static void deactivate() {
+  bp_unsubscribe();
+}
+
+static void load() {
+  /* the whole log is exported by default */
+  app.session_idx = -1;
+}
+
+SensiSmartApp AppExport = {
+  .name = "Export",
+  .window = NULL,
+  .activate = activate,
+  .deactivate = deactivate,
+  .load = load,
+  .window_load = on_load_window,
+  .window_unload = on_unload_window,
+  .max_ui_objects = 3
+};
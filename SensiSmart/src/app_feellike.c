@@ -38,16 +38,16 @@
 #include "utils.h"
 #include "app_feellike.h"
 
-/* Thresholds below which the feel like value applies */
-static const float COLD_THRESHOLD = -5.0f;
-static const float COOL_THRESHOLD = -2.5f;
+/* Thresholds in milli-degrees below which the feel like value applies */
+static const int32_t COLD_THRESHOLD = -5000;
+static const int32_t COOL_THRESHOLD = -2500;
 /** The relative baseline value - keep this at 0 */
-static const float BASE_THRESHOLD = 0.0f;
+static const int32_t BASE_THRESHOLD = 0;
 /** The default absolute temperature of the baseline value */
-static const float BASE_TEMPERATURE = 21.0f;
-static const float GOOD_THRESHOLD = +2.5f;
-static const float WARM_THRESHOLD = +5.0f;
-static const float HOT_THRESHOLD = INFINITY;
+static const int32_t BASE_TEMPERATURE = 21000;
+static const int32_t GOOD_THRESHOLD = +2500;
+static const int32_t WARM_THRESHOLD = +5000;
+static const int32_t HOT_THRESHOLD = INT32_MAX;
 
 static struct {
   Window *window;
@@ -55,18 +55,17 @@ static struct {
   TextLayer *comfort_level_layer;
   TextLayer *fl_text_layer;
   TextLayer *fl_temperature_layer;
-  TextLayer *logo_text_layer;
-  /** heat index baseline */
-  float hi_base;
+  /** heat index baseline in milli-degrees */
+  int32_t hi_base;
   /** heat index baseline is currently set manually */
   bool hi_base_is_set;
-  float last_t_feellike;
+  int32_t last_t_feellike;
   char time_buf[9];
-  char fl_temperature_buf[10];
+  ValueDisplay fl_temperature_display;
 } app;
 
-static const char *fl_comfort_level(float heat_index) {
-  float diff = heat_index - app.hi_base;
+static const char *fl_comfort_level(int32_t heat_index) {
+  int32_t diff = heat_index - app.hi_base;
   if (diff < COLD_THRESHOLD)
     return "cold";
   if (diff < COOL_THRESHOLD)
@@ -78,9 +77,9 @@ static const char *fl_comfort_level(float heat_index) {
   return "hot";
 }
 
-static GColor8 fl_color(float heat_index) {
+static GColor8 fl_color(int32_t heat_index) {
   /* https://developer.pebble.com/more/color-picker/ */
-  float diff = heat_index - app.hi_base;
+  int32_t diff = heat_index - app.hi_base;
   if (diff < COOL_THRESHOLD)
     return GColorBlue;
   if (diff < GOOD_THRESHOLD)
@@ -91,33 +90,40 @@ static GColor8 fl_color(float heat_index) {
 }
 
 static void update_clock() {
-  clock_copy_time_string(app.time_buf, sizeof(app.time_buf));
+  char time_buf[sizeof(app.time_buf)];
+  clock_copy_time_string(time_buf, sizeof(time_buf));
+  /* only redraw when the minute changed */
+  if (strcmp(time_buf, app.time_buf) == 0)
+    return;
+  strcpy(app.time_buf, time_buf);
   text_layer_set_text(app.time_layer, app.time_buf);
 }
 
 static void on_connection_state_changed(bool connected) {
   update_clock();
-  if (!connected) {
-    snprintf(app.fl_temperature_buf, sizeof(app.fl_temperature_buf), "-- °C");
-    text_layer_set_text(app.fl_temperature_layer, app.fl_temperature_buf);
-  }
+  if (!connected)
+    value_display_set_text(&app.fl_temperature_display, "-- °C");
 }
 
-static void on_processed_values(float t_skin, float t_feellike,
-                                float t_apparent, float t_humidex) {
-  char fbuf[16];
-  app.last_t_feellike = t_feellike;
+static void render() {
+  int32_t t_feellike = app.last_t_feellike;
   update_clock();
 
-  // Comfort level
-  text_layer_set_text_color(app.comfort_level_layer, fl_color(t_feellike));
-  text_layer_set_text(app.comfort_level_layer, fl_comfort_level(t_feellike));
+  // Comfort level, the color bands are a subset of the levels
+  const char *comfort_level = fl_comfort_level(t_feellike);
+  if (text_layer_get_text(app.comfort_level_layer) != comfort_level) {
+    text_layer_set_text_color(app.comfort_level_layer, fl_color(t_feellike));
+    text_layer_set_text(app.comfort_level_layer, comfort_level);
+  }
 
   // Feels like
-  ftoa(fbuf, t_feellike, 1);
-  snprintf(app.fl_temperature_buf, sizeof(app.fl_temperature_buf),
-           "%s °C", fbuf);
-  text_layer_set_text(app.fl_temperature_layer, app.fl_temperature_buf);
+  value_display_set_milli(&app.fl_temperature_display, t_feellike);
+}
+
+static void on_processed_values(int32_t t_skin, int32_t t_feellike,
+                                int32_t t_apparent, int32_t t_humidex) {
+  app.last_t_feellike = t_feellike;
+  sensismart_request_render(&AppFeellike);
 }
 
 static void on_load_window(Window *window) {
@@ -128,16 +134,19 @@ static void on_load_window(Window *window) {
   GFont comfort_level_font = fonts_get_system_font(FONT_KEY_BITHAM_30_BLACK);
 
   // app.time_layer
-  app.time_layer = text_layer_create(GRect(0, 5, 144, 38));
+  app.time_layer = sensismart_text_layer_create(&AppFeellike,
+                                                GRect(0, 5, 144, 38));
   text_layer_set_background_color(app.time_layer, GColorClear);
   text_layer_set_text_color(app.time_layer, GColorWhite);
   text_layer_set_text_alignment(app.time_layer, GTextAlignmentCenter);
   text_layer_set_font(app.time_layer, clock_font);
+  app.time_buf[0] = '\0';
   update_clock();
   layer_add_child(root_layer, (Layer *)app.time_layer);
 
   // app.comfort_level_layer
-  app.comfort_level_layer = text_layer_create(GRect(0, 50, 144, 35));
+  app.comfort_level_layer = sensismart_text_layer_create(&AppFeellike,
+                                                         GRect(0, 50, 144, 35));
   text_layer_set_background_color(app.comfort_level_layer, GColorClear);
   text_layer_set_text_color(app.comfort_level_layer, fl_color(app.last_t_feellike));
   text_layer_set_text(app.comfort_level_layer, fl_comfort_level(app.last_t_feellike));
@@ -146,7 +155,8 @@ static void on_load_window(Window *window) {
   layer_add_child(root_layer, (Layer *)app.comfort_level_layer);
 
   // app.fl_text_layer
-  app.fl_text_layer = text_layer_create(GRect(0, 95, 72, 24));
+  app.fl_text_layer = sensismart_text_layer_create(&AppFeellike,
+                                                   GRect(0, 95, 72, 24));
   text_layer_set_background_color(app.fl_text_layer, GColorClear);
   text_layer_set_text_color(app.fl_text_layer, GColorWhite);
   text_layer_set_text(app.fl_text_layer, "feels like");
@@ -155,24 +165,23 @@ static void on_load_window(Window *window) {
   layer_add_child(root_layer, (Layer *)app.fl_text_layer);
 
   // app.fl_temperature_layer
-  app.fl_temperature_layer = text_layer_create(GRect(72, 95, 72, 24));
+  app.fl_temperature_layer = sensismart_text_layer_create(&AppFeellike,
+                                                          GRect(72, 95, 72, 24));
   text_layer_set_background_color(app.fl_temperature_layer, GColorClear);
   text_layer_set_text_color(app.fl_temperature_layer, GColorWhite);
   text_layer_set_text(app.fl_temperature_layer, "-- °C");
   text_layer_set_font(app.fl_temperature_layer, text_font);
   text_layer_set_text_alignment(app.fl_temperature_layer, GTextAlignmentCenter);
   layer_add_child(root_layer, (Layer *)app.fl_temperature_layer);
+  value_display_init(&app.fl_temperature_display, app.fl_temperature_layer,
+                     NULL, " °C", 1);
 
   // Sensirion logo
   layer_add_child(root_layer, sensismart_get_branding_layer());
 }
 
 static void on_unload_window(Window *window) {
-  text_layer_destroy(app.time_layer);
-  text_layer_destroy(app.comfort_level_layer);
-  text_layer_destroy(app.fl_text_layer);
-  text_layer_destroy(app.fl_temperature_layer);
-  text_layer_destroy(app.logo_text_layer);
+  sensismart_ui_release(&AppFeellike);
   window_destroy(app.window);
 }
 
@@ -185,7 +194,7 @@ static void on_click_select(ClickRecognizerRef recognizer, void *context) {
     text_layer_set_text_color(app.fl_text_layer, GColorOrange);
   }
   app.hi_base_is_set = !app.hi_base_is_set;
-  on_processed_values(NAN, app.last_t_feellike, NAN, NAN);
+  render();
 }
 
 static void click_config_provider(Window *window) {
@@ -206,7 +215,7 @@ static void activate() {
   window_set_click_config_provider(app.window, (ClickConfigProvider) click_config_provider);
   bp_subscribe((BackpackHandlers) {
     .on_connection_state_changed = on_connection_state_changed,
-    .on_processed_values = on_processed_values
+    .on_processed_values_milli = on_processed_values
   });
   window_stack_push(app.window, true);
 }
@@ -216,10 +225,19 @@ static void deactivate() {
   bp_unsubscribe();
 }
 
+static void prefetch() {
+  bp_prefetch((BackpackHandlers) {
+    .on_processed_values_milli = on_processed_values
+  });
+}
+
 SensiSmartApp AppFeellike = {
   .name = "Feellike",
   .window = NULL,
   .activate = activate,
-  .deactivate = deactivate
+  .deactivate = deactivate,
+  .render = render,
+  .prefetch = prefetch,
+  .max_ui_objects = 4
 };
 
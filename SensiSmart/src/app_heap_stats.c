@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2016, Sensirion AG
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Sensirion AG nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pebble.h>
+#include "SensiSmartApp.h"
+#include "utils.h"
+#include "app_heap_stats.h"
+
+#define LONG_PRESS_INTERVAL 1000
+
+static const char *HEAP_STATS_TITLE = "Heap %u used %u free";
+
+static struct {
+  Window *window;
+  TextLayer *title_layer;
+  TextLayer *stats_text_layer;
+  char title_buf[32];
+  char stats_buf[160];
+  /** app whose statistics are shown */
+  int app_idx;
+} app;
+
+static void click_config_provider(Window *window);
+
+static void update_stats_text() {
+  snprintf(app.title_buf, sizeof(app.title_buf), HEAP_STATS_TITLE,
+           (unsigned) heap_bytes_used(), (unsigned) heap_bytes_free());
+  text_layer_set_text(app.title_layer, app.title_buf);
+
+  const struct sensismart_heap_stats *stats =
+      sensismart_get_heap_stats(app.app_idx);
+  if (!stats)
+    return;
+  snprintf(app.stats_buf, sizeof(app.stats_buf),
+           "%s (%ux)\n"
+           "Load:       %d B\n"
+           "Activate:  %d B\n"
+           "Held:       %d B\n"
+           "Growth:   %d B\n"
+           "Peak:       %u B\n"
+           "Min free: %u B",
+           sensismart_get_app(app.app_idx)->name,
+           (unsigned) stats->activations, (int) stats->load,
+           (int) stats->activate, (int) stats->held,
+           (int) (stats->held - stats->held_first),
+           (unsigned) stats->peak_used, (unsigned) stats->min_free);
+  text_layer_set_text(app.stats_text_layer, app.stats_buf);
+}
+
+static void on_load_window(Window *window) {
+  app.window = window;
+  window_set_click_config_provider(window, (ClickConfigProvider) click_config_provider);
+  Layer *root_layer = window_get_root_layer(window);
+  GFont font = fonts_get_system_font(FONT_KEY_GOTHIC_14);
+
+  app.title_layer = sensismart_text_layer_create(&AppHeapStats,
+                                                 GRect(0, 5, 144, 16));
+  text_layer_set_font(app.title_layer, font);
+  text_layer_set_text_color(app.title_layer, GColorWhite);
+  text_layer_set_background_color(app.title_layer, GColorBlack);
+  text_layer_set_text_alignment(app.title_layer, GTextAlignmentCenter);
+  layer_add_child(root_layer, text_layer_get_layer(app.title_layer));
+
+  app.stats_text_layer = sensismart_text_layer_create(&AppHeapStats,
+                                                      GRect(0, 28, 144, 105));
+  text_layer_set_font(app.stats_text_layer, font);
+  text_layer_set_text_color(app.stats_text_layer, GColorBrightGreen);
+  text_layer_set_background_color(app.stats_text_layer, GColorBlack);
+  text_layer_set_overflow_mode(app.stats_text_layer, GTextOverflowModeWordWrap);
+  layer_add_child(root_layer, text_layer_get_layer(app.stats_text_layer));
+
+  layer_add_child(root_layer, sensismart_get_branding_layer());
+}
+
+static void on_unload_window(Window *window) {
+  app.window = NULL;
+}
+
+static void on_click_select(ClickRecognizerRef recognizer, void *context) {
+  app.app_idx = (app.app_idx + 1) % sensismart_get_num_apps();
+  update_stats_text();
+}
+
+static void on_long_click_select(ClickRecognizerRef recognizer, void *context) {
+  sensismart_log_heap_stats();
+}
+
+static void click_config_provider(Window *window) {
+  sensismart_setup_controls(&AppHeapStats);
+  window_single_click_subscribe(BUTTON_ID_SELECT, on_click_select);
+  window_long_click_subscribe(BUTTON_ID_SELECT, LONG_PRESS_INTERVAL,
+                              on_long_click_select, NULL);
+}
+
+static void activate() {
+  update_stats_text();
+}
+
+static void deactivate() {
+}
+
+SensiSmartApp AppHeapStats = {
+  .name = "HeapStats",
+  .window = NULL,
+  .activate = activate,
+  .deactivate = deactivate,
+  .window_load = on_load_window,
+  .window_unload = on_unload_window,
+  .max_ui_objects = 2
+};
@@ -33,42 +33,63 @@
 #include <pebble.h>
 #include "backpack.h"
 #include "SensiSmartApp.h"
+#include "scheduler.h"
 #include "utils.h"
 #include "app_logger.h"
 
 #define LONG_PRESS_INTERVAL_MS 1000
 
 static const char *LOGGING_TITLE = "Logging";
+static const char *LOGGING_SESSION_TITLE = "Logging #%d";
+static const char *WRAP_AROUND_TITLE_SUFFIX = " (overwrite)";
 
 static const char *LOG_CLEAR_TEXT     = "Press mid button to clear log";
 static const char *LOG_CLEARING_TEXT  = "Clearing log...\n%d";
 static const char *LOG_START_TEXT     = "Press mid button to start logging";
 static const char *LOG_STOP_TEXT      = "Press mid button to stop logging";
 static const char *LOG_CONTINUE_TEXT  = "Press mid button to continue";
+static const char *LOG_NEW_SESSION_TEXT  = "Press: new session\nHold: clear log";
+static const char *LOG_NEXT_SESSION_TEXT = "Press mid button for next session";
+static const char *LOG_FULL_TEXT      = "Log full, hold mid button to clear";
 
 static struct {
   Window *window;
   TextLayer *title_layer;
   TextLayer *log_text_layer;
   char log_text_layer_buf[20];
-  AppTimer *clear_log_timer;
-  Dialog dialog;
+  char title_buf[24];
+  SchedTimer clear_log_timer;
 } app;
 
 static void click_config_provider(Window *window);
 static void on_log_clear_tick(void *data);
 
-static void update_dialog_view_state(bool connected) {
-  layer_set_hidden(app.dialog.layer, connected);
+static void update_connection_view_state(bool connected) {
+  /* the disconnect warning is shown by the framework */
   layer_set_hidden(text_layer_get_layer(app.log_text_layer), !connected);
 }
 
+static void update_title_text() {
+  int len;
+  if (bp_log_sessions_supported() && bp_log_get_num_sessions() > 0) {
+    len = snprintf(app.title_buf, sizeof(app.title_buf),
+                   LOGGING_SESSION_TITLE, bp_log_get_num_sessions());
+  } else {
+    len = snprintf(app.title_buf, sizeof(app.title_buf), "%s", LOGGING_TITLE);
+  }
+  if (bp_log_get_wrap_around())
+    snprintf(app.title_buf + len, sizeof(app.title_buf) - len, "%s",
+             WRAP_AROUND_TITLE_SUFFIX);
+  text_layer_set_text(app.title_layer, app.title_buf);
+}
+
 static void update_log_status_text(enum bp_log_status status, time_t remaining) {
   layer_set_frame(text_layer_get_layer(app.log_text_layer), GRect(0, 25, 144, 100));
 
   switch (status) {
   case STATUS_LOG_DIRTY:
-    text_layer_set_text(app.log_text_layer, LOG_CLEAR_TEXT);
+    text_layer_set_text(app.log_text_layer, bp_log_sessions_supported() ?
+                        LOG_NEW_SESSION_TEXT : LOG_CLEAR_TEXT);
     break;
 
   case STATUS_LOG_CLEARING:
@@ -88,37 +109,54 @@ static void update_log_status_text(enum bp_log_status status, time_t remaining)
     break;
 
   case STATUS_LOG_STOPPED:
-    text_layer_set_text(app.log_text_layer, LOG_CONTINUE_TEXT);
+    text_layer_set_text(app.log_text_layer, bp_log_sessions_supported() ?
+                        LOG_NEXT_SESSION_TEXT : LOG_CONTINUE_TEXT);
+    break;
+
+  case STATUS_LOG_FULL:
+    text_layer_set_text(app.log_text_layer, LOG_FULL_TEXT);
     break;
   }
 
-  update_dialog_view_state(bp_get_status());
+  update_connection_view_state(bp_get_status());
   layer_mark_dirty(text_layer_get_layer(app.log_text_layer));
 }
 
 static void on_log_interrupt() {
-  update_log_status_text(bp_log_get_status(), 0);
+  enum bp_log_status status = bp_log_get_status();
+  update_title_text();
+  if (status == STATUS_LOG_CLEARING) {
+    if (!app.clear_log_timer)
+      on_log_clear_tick(NULL);
+    return;
+  }
+  /* the erase may complete before the estimated clear time */
+  if (app.clear_log_timer) {
+    sched_cancel(app.clear_log_timer);
+    app.clear_log_timer = SCHED_TIMER_NONE;
+  }
+  update_log_status_text(status, 0);
 }
 
 static void on_connection_state_changed(bool connected) {
-  update_dialog_view_state(connected);
+  update_connection_view_state(connected);
 }
 
 static void on_load_window(Window *window) {
-  sensismart_window_load(&AppLogger);
+  app.window = window;
+  window_set_click_config_provider(window, (ClickConfigProvider) click_config_provider);
   Layer *root_layer = window_get_root_layer(window);
 
   // Screen Title
-  app.title_layer = text_layer_create(GRect(0, 0, 144, 30));
+  app.title_layer = sensismart_text_layer_create(&AppLogger, GRect(0, 0, 144, 30));
   text_layer_set_font(app.title_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18));
-  text_layer_set_text(app.title_layer, LOGGING_TITLE);
   text_layer_set_text_color(app.title_layer, GColorWhite);
   text_layer_set_background_color(app.title_layer, GColorBlack);
   text_layer_set_text_alignment(app.title_layer, GTextAlignmentCenter);
   layer_add_child(root_layer, text_layer_get_layer(app.title_layer));
 
   // Logging Status
-  app.log_text_layer = text_layer_create(GRect(0, 25, 144, 100));
+  app.log_text_layer = sensismart_text_layer_create(&AppLogger, GRect(0, 25, 144, 100));
   text_layer_set_font(app.log_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_28));
   text_layer_set_text_color(app.log_text_layer, GColorBrightGreen);
   text_layer_set_background_color(app.log_text_layer, GColorBlack);
@@ -128,99 +166,112 @@ static void on_load_window(Window *window) {
 
   // Sensirion Logo
   layer_add_child(root_layer, sensismart_get_branding_layer());
-
-  // Dialog Box for Disconnect Events
-  dialog_create_disconnect_warning(&app.dialog);
-  layer_add_child(root_layer, app.dialog.layer);
-
-  update_dialog_view_state(bp_get_status());
-
-  enum bp_log_status status = bp_log_get_status();
-  if (status == STATUS_LOG_CLEARING)
-    on_log_clear_tick(NULL);
-  else
-    update_log_status_text(status, 0);
 }
 
 static void on_unload_window(Window *window) {
-  text_layer_destroy(app.title_layer);
-  text_layer_destroy(app.log_text_layer);
-  dialog_destroy(&app.dialog);
-  window_destroy(app.window);
+  app.window = NULL;
 }
 
 static void on_log_clear_tick(void *data) {
   time_t remaining = bp_log_remaining();
   if (remaining <= 0) {
-    app.clear_log_timer = NULL;
+    app.clear_log_timer = SCHED_TIMER_NONE;
     update_log_status_text(STATUS_LOG_CLEARED, 0);
   } else {
     update_log_status_text(STATUS_LOG_CLEARING, remaining);
-    app.clear_log_timer =
-        app_timer_register(1000, (AppTimerCallback) on_log_clear_tick, NULL);
+    app.clear_log_timer = sched_register(1000, 0, on_log_clear_tick, NULL);
   }
 }
 
-static void on_click_select(ClickRecognizerRef recognizer, void *context) {
+static void on_long_click_select(ClickRecognizerRef recognizer, void *context) {
   if (!bp_get_status())
     return;
 
-  enum bp_log_status status = bp_log_get_status();
-  uint8_t click = click_number_of_clicks_counted(recognizer);
-  if (click > 3 || status == STATUS_LOG_CLEARING)
-    return;
-  if (click > 1 && status > STATUS_LOG_CLEARED)
+  switch (bp_log_get_status()) {
+  case STATUS_LOG_DIRTY:
+  case STATUS_LOG_FULL:
+    INFO("Forcing log clearing");
+    bp_log_clear();
+    on_log_clear_tick(NULL);
+    break;
+
+  case STATUS_LOG_STARTED:
+    /* the mode changes while the log keeps recording */
+    bp_log_set_wrap_around(!bp_log_get_wrap_around());
+    update_title_text();
+    break;
+
+  default:
+    break;
+  }
+}
+
+static void on_click_select(ClickRecognizerRef recognizer, void *context) {
+  if (!bp_get_status())
     return;
 
-  if (status < STATUS_LOG_CLEARED) {
-    if (click == 1) {
+  enum bp_log_status status = bp_log_get_status();
+  switch (status) {
+  case STATUS_LOG_DIRTY:
+    /* append a new session instead of clearing the whole log */
+    if (bp_log_new_session())
+      text_layer_set_text(app.log_text_layer, LOG_STOP_TEXT);
+    else
       text_layer_set_text(app.log_text_layer, LOG_CLEAR_TEXT);
-    } else if (bp_get_status()) {
-      /* click 2 is sent right after 1, only click 3 is delayed correctly */
-      if (click == 3)
-        INFO("Forcing log clearing");
-      else
-        return;
-      bp_log_clear();
-      on_log_clear_tick(NULL);
-    }
-  } else if (status == STATUS_LOG_CLEARED ||
-             status == STATUS_LOG_STOPPED) {
-    bp_log_start();
+    break;
+
+  case STATUS_LOG_FULL:
+    text_layer_set_text(app.log_text_layer, LOG_FULL_TEXT);
+    break;
+
+  case STATUS_LOG_CLEARED:
+  case STATUS_LOG_STOPPED:
+    if (!bp_log_new_session())
+      bp_log_start();
     text_layer_set_text(app.log_text_layer, LOG_STOP_TEXT);
-  } else if (status == STATUS_LOG_STARTED) {
+    break;
+
+  case STATUS_LOG_STARTED:
     bp_log_stop();
-    text_layer_set_text(app.log_text_layer, LOG_CONTINUE_TEXT);
+    text_layer_set_text(app.log_text_layer, bp_log_sessions_supported() ?
+                        LOG_NEXT_SESSION_TEXT : LOG_CONTINUE_TEXT);
+    break;
+
+  case STATUS_LOG_CLEARING:
+    break;
   }
 }
 
 static void click_config_provider(Window *window) {
   sensismart_setup_controls(&AppLogger);
-  window_single_repeating_click_subscribe(BUTTON_ID_SELECT,
-                                          LONG_PRESS_INTERVAL_MS,
-                                          on_click_select);
+  /* a hold only triggers the long click, never the single click */
+  window_single_click_subscribe(BUTTON_ID_SELECT, on_click_select);
+  window_long_click_subscribe(BUTTON_ID_SELECT, LONG_PRESS_INTERVAL_MS,
+                              on_long_click_select, NULL);
 }
 
 static void activate() {
-  AppLogger.window = window_create();
-  app.window = AppLogger.window;
-  app.clear_log_timer = NULL;
-  window_set_window_handlers(app.window, (WindowHandlers) {
-    .load = on_load_window,
-    .unload = on_unload_window
-  });
-  window_set_click_config_provider(app.window, (ClickConfigProvider) click_config_provider);
+  app.clear_log_timer = SCHED_TIMER_NONE;
   bp_subscribe((BackpackHandlers) {
     .on_connection_state_changed = on_connection_state_changed
   });
   bp_set_log_interrupt_handler(on_log_interrupt);
-  window_stack_push(app.window, true);
+
+  /* the window may be kept from an earlier activation */
+  update_title_text();
+  update_connection_view_state(bp_get_status());
+  enum bp_log_status status = bp_log_get_status();
+  if (status == STATUS_LOG_CLEARING)
+    on_log_clear_tick(NULL);
+  else
+    update_log_status_text(status, 0);
 }
 
 static void deactivate() {
-  window_stack_pop(true);
-  if (app.clear_log_timer)
-    app_timer_cancel(app.clear_log_timer);
+  if (app.clear_log_timer) {
+    sched_cancel(app.clear_log_timer);
+    app.clear_log_timer = SCHED_TIMER_NONE;
+  }
   bp_unsubscribe();
 }
 
@@ -228,6 +279,9 @@ SensiSmartApp AppLogger = {
   .name = "Logger",
   .window = NULL,
   .activate = activate,
-  .deactivate = deactivate
+  .deactivate = deactivate,
+  .window_load = on_load_window,
+  .window_unload = on_unload_window,
+  .max_ui_objects = 2
 };
 
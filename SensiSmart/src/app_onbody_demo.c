@@ -45,13 +45,8 @@ static struct {
   TextLayer *title_layer;
   TextLayer *onbody_text_layer;
   bool onbody_state;
-  Dialog dialog;
 } app;
 
-static void update_connection_text(bool connected) {
-  layer_set_hidden(app.dialog.layer, connected);
-}
-
 static void update_onbody_state_text(bool onbody) {
   text_layer_set_text(app.onbody_text_layer, ONBODY_TEXT[onbody]);
   text_layer_set_background_color(app.onbody_text_layer, ONBODY_COLOR[onbody]);
@@ -81,24 +76,14 @@ static void on_load_window(Window *window) {
 
   // Sensirion Logo
   layer_add_child(root_layer, sensismart_get_branding_layer());
-
-  // Dialog Box for Disconnect Events
-  dialog_create_disconnect_warning(&app.dialog);
-  layer_add_child(root_layer, app.dialog.layer);
-  layer_set_hidden(app.dialog.layer, bp_get_status());
 }
 
 static void on_unload_window(Window *window) {
   text_layer_destroy(app.title_layer);
   text_layer_destroy(app.onbody_text_layer);
-  dialog_destroy(&app.dialog);
   window_destroy(app.window);
 }
 
-static void on_connection_state_changed(bool connected) {
-  update_connection_text(connected);
-}
-
 static void on_onbody_event(bool onbody) {
   app.onbody_state = onbody;
   update_onbody_state_text(onbody);
@@ -118,7 +103,6 @@ static void activate() {
   window_set_click_config_provider(app.window, (ClickConfigProvider) click_config_provider);
   window_stack_push(app.window, true);
   bp_subscribe((BackpackHandlers) {
-    .on_connection_state_changed = on_connection_state_changed,
     .on_onbody_event = on_onbody_event
   });
 }
@@ -42,9 +42,13 @@ static struct {
   TextLayer *attr_text_layer;
   TextLayer *raw_text_layer;
   TextLayer *skin_text_layer;
-  char attr_text_layer_buf[20];
-  char raw_text_layer_buf[20];
-  char skin_text_layer_buf[20];
+  ValueDisplay attr_display;
+  ValueDisplay raw_display;
+  ValueDisplay skin_display;
+  /** latest readings, shown by render() */
+  int32_t t_c;
+  int32_t rh;
+  int32_t t_skin;
 } app;
 
 static void update_connection_text(bool connected) {
@@ -62,7 +66,8 @@ static void on_connection_state_changed(bool connected) {
 static void on_load_window(Window *window) {
   sensismart_window_load(&AppRaw);
   Layer *root_layer = window_get_root_layer(window);
-  app.status_layer = text_layer_create(GRect(0, 5, 144, 40));
+  app.status_layer = sensismart_text_layer_create(&AppRaw,
+                                                  GRect(0, 5, 144, 40));
   text_layer_set_font(app.status_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18));
   update_connection_text(bp_get_status());
   text_layer_set_text_color(app.status_layer, GColorWhite);
@@ -71,7 +76,8 @@ static void on_load_window(Window *window) {
   text_layer_set_overflow_mode(app.status_layer, GTextOverflowModeWordWrap);
   layer_add_child(root_layer, text_layer_get_layer(app.status_layer));
 
-  app.attr_text_layer = text_layer_create(GRect(0, 28, 144, 40));
+  app.attr_text_layer = sensismart_text_layer_create(&AppRaw,
+                                                     GRect(0, 28, 144, 40));
   text_layer_set_font(app.attr_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_28));
   text_layer_set_text(app.attr_text_layer, "-");
   text_layer_set_text_color(app.attr_text_layer, GColorBrightGreen);
@@ -79,8 +85,10 @@ static void on_load_window(Window *window) {
   text_layer_set_text_alignment(app.attr_text_layer, GTextAlignmentCenter);
   text_layer_set_overflow_mode(app.attr_text_layer, GTextOverflowModeWordWrap);
   layer_add_child(root_layer, text_layer_get_layer(app.attr_text_layer));
+  value_display_init(&app.attr_display, app.attr_text_layer, NULL, " °C", 2);
 
-  app.raw_text_layer = text_layer_create(GRect(0, 60, 144, 40));
+  app.raw_text_layer = sensismart_text_layer_create(&AppRaw,
+                                                    GRect(0, 60, 144, 40));
   text_layer_set_font(app.raw_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_28));
   text_layer_set_text(app.raw_text_layer, "-");
   text_layer_set_text_color(app.raw_text_layer, GColorBrightGreen);
@@ -88,8 +96,10 @@ static void on_load_window(Window *window) {
   text_layer_set_text_alignment(app.raw_text_layer, GTextAlignmentCenter);
   text_layer_set_overflow_mode(app.raw_text_layer, GTextOverflowModeWordWrap);
   layer_add_child(root_layer, text_layer_get_layer(app.raw_text_layer));
+  value_display_init(&app.raw_display, app.raw_text_layer, NULL, " %RH", 2);
 
-  app.skin_text_layer = text_layer_create(GRect(0, 92, 144, 40));
+  app.skin_text_layer = sensismart_text_layer_create(&AppRaw,
+                                                     GRect(0, 92, 144, 40));
   text_layer_set_font(app.skin_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_28));
   text_layer_set_text(app.skin_text_layer, "-");
   text_layer_set_text_color(app.skin_text_layer, GColorBrightGreen);
@@ -97,38 +107,32 @@ static void on_load_window(Window *window) {
   text_layer_set_text_alignment(app.skin_text_layer, GTextAlignmentCenter);
   text_layer_set_overflow_mode(app.skin_text_layer, GTextOverflowModeWordWrap);
   layer_add_child(root_layer, text_layer_get_layer(app.skin_text_layer));
+  value_display_init(&app.skin_display, app.skin_text_layer, NULL, " °C", 2);
 
   layer_add_child(root_layer, sensismart_get_branding_layer());
 }
 
 static void on_unload_window(Window *window) {
-  text_layer_destroy(app.status_layer);
-  text_layer_destroy(app.attr_text_layer);
-  text_layer_destroy(app.raw_text_layer);
-  text_layer_destroy(app.skin_text_layer);
+  sensismart_ui_release(&AppRaw);
   window_destroy(app.window);
 }
 
-static void on_sensor_readings(int32_t t_c, int32_t rh, int32_t t_skin, int16_t reserved0, int16_t reserved1) {
-  char fbuf[16];
-
+static void render() {
   /* Temperature */
-  ftoa(fbuf, FIXP_FLOAT(t_c, 1000), 2);
-  snprintf(app.attr_text_layer_buf, sizeof(app.attr_text_layer_buf),
-           "%s °C", fbuf);
-  text_layer_set_text(app.attr_text_layer, app.attr_text_layer_buf);
+  value_display_set_milli(&app.attr_display, app.t_c);
 
   /* Humidity */
-  ftoa(fbuf, FIXP_FLOAT(rh, 1000), 2);
-  snprintf(app.raw_text_layer_buf, sizeof(app.raw_text_layer_buf),
-           "%s %%RH", fbuf);
-  text_layer_set_text(app.raw_text_layer, app.raw_text_layer_buf);
+  value_display_set_milli(&app.raw_display, app.rh);
 
   /* Skin Raw Temperature */
-  ftoa(fbuf, FIXP_FLOAT(t_skin, 1000), 2);
-  snprintf(app.skin_text_layer_buf, sizeof(app.skin_text_layer_buf),
-           "%s °C", fbuf);
-  text_layer_set_text(app.skin_text_layer, app.skin_text_layer_buf);
+  value_display_set_milli(&app.skin_display, app.t_skin);
+}
+
+static void on_sensor_readings(int32_t t_c, int32_t rh, int32_t t_skin, int16_t reserved0, int16_t reserved1) {
+  app.t_c = t_c;
+  app.rh = rh;
+  app.t_skin = t_skin;
+  sensismart_request_render(&AppRaw);
 }
 
 static void click_config_provider(Window *window) {
@@ -155,10 +159,19 @@ static void deactivate() {
   bp_unsubscribe();
 }
 
+static void prefetch() {
+  bp_prefetch((BackpackHandlers) {
+    .on_sensor_readings = on_sensor_readings
+  });
+}
+
 SensiSmartApp AppRaw = {
   .name = "Raw",
   .window = NULL,
   .activate = activate,
-  .deactivate = deactivate
+  .deactivate = deactivate,
+  .render = render,
+  .prefetch = prefetch,
+  .max_ui_objects = 4
 };
 
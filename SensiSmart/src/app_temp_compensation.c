@@ -42,9 +42,13 @@ static struct {
   TextLayer *skin_text_layer;
   TextLayer *feel_like_text_layer;
   TextLayer *apparent_text_layer;
-  char skin_text_layer_buf[20];
-  char feel_like_text_layer_buf[20];
-  char apparent_text_layer_buf[20];
+  ValueDisplay skin_display;
+  ValueDisplay feel_like_display;
+  ValueDisplay apparent_display;
+  /** latest processed values in milli-degrees, shown by render() */
+  int32_t t_skin;
+  int32_t t_feellike;
+  int32_t t_apparent;
 } app;
 
 static void update_connection_text(bool connected) {
@@ -63,7 +67,8 @@ static void on_load_window(Window *window) {
   sensismart_window_load(&AppTempCompensation);
   Layer *root_layer = window_get_root_layer(window);
 
-  app.status_layer = text_layer_create(GRect(0, 5, 144, 40));
+  app.status_layer = sensismart_text_layer_create(&AppTempCompensation,
+                                                  GRect(0, 5, 144, 40));
   text_layer_set_font(app.status_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18));
   update_connection_text(bp_get_status());
   text_layer_set_text_color(app.status_layer, GColorWhite);
@@ -72,7 +77,8 @@ static void on_load_window(Window *window) {
   text_layer_set_overflow_mode(app.status_layer, GTextOverflowModeWordWrap);
   layer_add_child(root_layer, text_layer_get_layer(app.status_layer));
 
-  app.skin_text_layer = text_layer_create(GRect(0, 28, 144, 40));
+  app.skin_text_layer = sensismart_text_layer_create(&AppTempCompensation,
+                                                     GRect(0, 28, 144, 40));
   text_layer_set_font(app.skin_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_28));
   text_layer_set_text(app.skin_text_layer, "-");
   text_layer_set_text_color(app.skin_text_layer, GColorBrightGreen);
@@ -80,8 +86,10 @@ static void on_load_window(Window *window) {
   text_layer_set_text_alignment(app.skin_text_layer, GTextAlignmentCenter);
   text_layer_set_overflow_mode(app.skin_text_layer, GTextOverflowModeWordWrap);
   layer_add_child(root_layer, text_layer_get_layer(app.skin_text_layer));
+  value_display_init(&app.skin_display, app.skin_text_layer, NULL, " °C", 2);
 
-  app.feel_like_text_layer = text_layer_create(GRect(0, 60, 144, 40));
+  app.feel_like_text_layer = sensismart_text_layer_create(&AppTempCompensation,
+                                                          GRect(0, 60, 144, 40));
   text_layer_set_font(app.feel_like_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_28));
   text_layer_set_text(app.feel_like_text_layer, "-");
   text_layer_set_text_color(app.feel_like_text_layer, GColorBrightGreen);
@@ -89,8 +97,10 @@ static void on_load_window(Window *window) {
   text_layer_set_text_alignment(app.feel_like_text_layer, GTextAlignmentCenter);
   text_layer_set_overflow_mode(app.feel_like_text_layer, GTextOverflowModeWordWrap);
   layer_add_child(root_layer, text_layer_get_layer(app.feel_like_text_layer));
+  value_display_init(&app.feel_like_display, app.feel_like_text_layer, NULL, " °C", 2);
 
-  app.apparent_text_layer = text_layer_create(GRect(0, 92, 144, 40));
+  app.apparent_text_layer = sensismart_text_layer_create(&AppTempCompensation,
+                                                         GRect(0, 92, 144, 40));
   text_layer_set_font(app.apparent_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_28));
   text_layer_set_text(app.apparent_text_layer, "-");
   text_layer_set_text_color(app.apparent_text_layer, GColorBrightGreen);
@@ -98,39 +108,33 @@ static void on_load_window(Window *window) {
   text_layer_set_text_alignment(app.apparent_text_layer, GTextAlignmentCenter);
   text_layer_set_overflow_mode(app.apparent_text_layer, GTextOverflowModeWordWrap);
   layer_add_child(root_layer, text_layer_get_layer(app.apparent_text_layer));
+  value_display_init(&app.apparent_display, app.apparent_text_layer, NULL, " °C", 2);
 
   layer_add_child(root_layer, sensismart_get_branding_layer());
 }
 
 static void on_unload_window(Window *window) {
-  text_layer_destroy(app.status_layer);
-  text_layer_destroy(app.skin_text_layer);
-  text_layer_destroy(app.feel_like_text_layer);
-  text_layer_destroy(app.apparent_text_layer);
+  sensismart_ui_release(&AppTempCompensation);
   window_destroy(app.window);
 }
 
-static void on_processed_values(float t_skin, float t_feellike,
-                                float t_apparent, float t_humidex) {
-  char fbuf[16];
-
+static void render() {
   /* skin temperature */
-  ftoa(fbuf, t_skin, 2);
-  snprintf(app.skin_text_layer_buf, sizeof(app.skin_text_layer_buf),
-           "%s °C", fbuf);
-  text_layer_set_text(app.skin_text_layer, app.skin_text_layer_buf);
+  value_display_set_milli(&app.skin_display, app.t_skin);
 
   /* feellike temperature */
-  ftoa(fbuf, t_feellike, 2);
-  snprintf(app.feel_like_text_layer_buf, sizeof(app.feel_like_text_layer_buf),
-           "%s °C", fbuf);
-  text_layer_set_text(app.feel_like_text_layer, app.feel_like_text_layer_buf);
+  value_display_set_milli(&app.feel_like_display, app.t_feellike);
 
   /* apparent temperature */
-  ftoa(fbuf, t_apparent, 2);
-  snprintf(app.apparent_text_layer_buf, sizeof(app.apparent_text_layer_buf),
-           "%s °C", fbuf);
-  text_layer_set_text(app.apparent_text_layer, app.apparent_text_layer_buf);
+  value_display_set_milli(&app.apparent_display, app.t_apparent);
+}
+
+static void on_processed_values(int32_t t_skin, int32_t t_feellike,
+                                int32_t t_apparent, int32_t t_humidex) {
+  app.t_skin = t_skin;
+  app.t_feellike = t_feellike;
+  app.t_apparent = t_apparent;
+  sensismart_request_render(&AppTempCompensation);
 }
 
 static void click_config_provider(Window *window) {
@@ -147,7 +151,7 @@ static void activate() {
   window_set_click_config_provider(app.window, (ClickConfigProvider) click_config_provider);
   bp_subscribe((BackpackHandlers) {
     .on_connection_state_changed = on_connection_state_changed,
-    .on_processed_values = on_processed_values
+    .on_processed_values_milli = on_processed_values
   });
   window_stack_push(app.window, true);
 }
@@ -157,10 +161,19 @@ static void deactivate() {
   bp_unsubscribe();
 }
 
+static void prefetch() {
+  bp_prefetch((BackpackHandlers) {
+    .on_processed_values_milli = on_processed_values
+  });
+}
+
 SensiSmartApp AppTempCompensation = {
   .name = "TempCompensation",
   .window = NULL,
   .activate = activate,
-  .deactivate = deactivate
+  .deactivate = deactivate,
+  .render = render,
+  .prefetch = prefetch,
+  .max_ui_objects = 4
 };
 
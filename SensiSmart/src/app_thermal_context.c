@@ -56,6 +56,18 @@ static struct {
   int max;
 } CONTEXT_RANGES[] = {{0, 40}, {14, 34}, {10, 35}};
 
+/** Needle angles at the ends of the scale */
+#define ANGLE_MIN (-10 * TRIG_MAX_ANGLE / 360)
+#define ANGLE_MAX (190 * TRIG_MAX_ANGLE / 360)
+/** Widest range of a context in degrees, the recalibration uses 40 */
+#define MAX_RANGE_DEGREES 40
+
+/**
+ * Needle angle for every full degree of a context range, angle_lut[i] is the
+ * angle at min + i. Recomputed by update_angle_lut() when the range changes.
+ */
+static int32_t angle_lut[ARRAY_LENGTH(CONTEXT_RANGES)][MAX_RANGE_DEGREES + 1];
+
 static struct {
   Window *window;
   TextLayer *title_layer;
@@ -63,10 +75,10 @@ static struct {
   BitmapLayer *bmp_context_layer;
   Layer *meter_layer;
   GPath *indicator_path;
-  float current_humidex;
+  /** humidex in 1/10 degrees */
+  int32_t current_humidex;
   int current_context_idx;
   TextLayer *context_type_layer;
-  Dialog dialog;
 } app;
 
 static void init_bp_subscriptions();
@@ -76,30 +88,35 @@ static const GPathInfo INDICATOR_PATH_INFO = {
   .points = (GPoint []) {{0, -6}, {-30, 0}, {0, 5}, {6, 0}, {0, -6}}
 };
 
-static void update_connection_text(bool connected) {
-  layer_set_hidden(app.dialog.layer, connected);
-}
-
 static void on_connection_state_changed(bool connected) {
-  update_connection_text(connected);
   if (connected) {
     bp_unsubscribe();
     init_bp_subscriptions();
   }
 }
 
-static int32_t angle_for_temperature(float temp) {
-  if (temp <= CONTEXT_RANGES[app.current_context_idx].min) {
-    return -10 * TRIG_MAX_ANGLE / 360;
-  } else if (temp >= CONTEXT_RANGES[app.current_context_idx].max) {
-    return 190 * TRIG_MAX_ANGLE / 360;
-  } else {
-    return (int32_t) -10 * TRIG_MAX_ANGLE / 360
-           + (200.0f * TRIG_MAX_ANGLE * (temp - CONTEXT_RANGES[app.current_context_idx].min)
-           / (360 * (CONTEXT_RANGES[app.current_context_idx].max - CONTEXT_RANGES[app.current_context_idx].min)));
+static void update_angle_lut(int context_idx) {
+  int span = CONTEXT_RANGES[context_idx].max - CONTEXT_RANGES[context_idx].min;
+  if (span > MAX_RANGE_DEGREES)
+    span = MAX_RANGE_DEGREES;
+  for (int i = 0; i <= MAX_RANGE_DEGREES; ++i) {
+    angle_lut[context_idx][i] = i < span ?
+      ANGLE_MIN + (ANGLE_MAX - ANGLE_MIN) * i / span : ANGLE_MAX;
   }
 }
 
+/** Angle for a temperature in 1/10 degrees, interpolated between degrees */
+static int32_t angle_for_temperature(int32_t temp_deci) {
+  const int32_t *lut = angle_lut[app.current_context_idx];
+  int32_t offset = temp_deci - CONTEXT_RANGES[app.current_context_idx].min * 10;
+  if (offset <= 0)
+    return ANGLE_MIN;
+  if (offset >= MAX_RANGE_DEGREES * 10)
+    return ANGLE_MAX;
+  int32_t i = offset / 10;
+  return lut[i] + (lut[i + 1] - lut[i]) * (offset % 10) / 10;
+}
+
 static void on_indicator_update_proc(Layer *layer, GContext *ctx) {
   int32_t angle = angle_for_temperature(app.current_humidex);
   gpath_rotate_to(app.indicator_path, angle);
@@ -110,7 +127,8 @@ static void on_indicator_update_proc(Layer *layer, GContext *ctx) {
 }
 
 static void init_indicator() {
-  app.indicator_path = gpath_create(&INDICATOR_PATH_INFO);
+  app.indicator_path = sensismart_gpath_create(&AppThermalContext,
+                                               &INDICATOR_PATH_INFO);
   layer_set_update_proc(app.meter_layer, on_indicator_update_proc);
 }
 
@@ -119,7 +137,8 @@ static void on_load_window(Window *window) {
   Layer *root_layer = window_get_root_layer(window);
 
   // Screen Title
-  app.title_layer = text_layer_create(GRect(0, 0, 144, 20));
+  app.title_layer = sensismart_text_layer_create(&AppThermalContext,
+                                                 GRect(0, 0, 144, 20));
   text_layer_set_font(app.title_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18));
   text_layer_set_text(app.title_layer, THERMAL_CONTEXT_TITLE);
   text_layer_set_text_color(app.title_layer, GColorWhite);
@@ -131,57 +150,47 @@ static void on_load_window(Window *window) {
   layer_add_child(root_layer, sensismart_get_branding_layer());
 
   // Context Scale
-  app.res_bmp_context = gbitmap_create_with_resource(CONTEXT_RESOURCES[app.current_context_idx]);
-  app.bmp_context_layer = bitmap_layer_create(GRect(5, 27, 134, 102));
+  app.res_bmp_context = sensismart_bitmap_acquire(CONTEXT_RESOURCES[app.current_context_idx]);
+  app.bmp_context_layer = sensismart_bitmap_layer_create(&AppThermalContext,
+                                                         GRect(5, 27, 134, 102));
   bitmap_layer_set_bitmap(app.bmp_context_layer, app.res_bmp_context);
   layer_add_child(root_layer, (Layer *)app.bmp_context_layer);
 
   // Indicator layer
-  app.meter_layer = layer_create(GRect(0, 0, METER_WIDTH, METER_HEIGHT));
+  app.meter_layer = sensismart_layer_create(&AppThermalContext,
+                                            GRect(0, 0, METER_WIDTH, METER_HEIGHT));
   layer_add_child(root_layer, app.meter_layer);
   init_indicator();
 
   // Context Type Description
-  app.context_type_layer = text_layer_create(GRect(0, 113, 144, 20));
+  app.context_type_layer = sensismart_text_layer_create(&AppThermalContext,
+                                                        GRect(0, 113, 144, 20));
   text_layer_set_font(app.context_type_layer, fonts_get_system_font(FONT_KEY_GOTHIC_14));
   text_layer_set_text(app.context_type_layer, CONTEXT_TITLES[app.current_context_idx]);
   text_layer_set_text_color(app.context_type_layer, GColorWhite);
   text_layer_set_background_color(app.context_type_layer, GColorClear);
   text_layer_set_text_alignment(app.context_type_layer, GTextAlignmentCenter);
   layer_add_child(root_layer, text_layer_get_layer(app.context_type_layer));
-
-  // Dialog Box for Disconnect Events
-  dialog_create_disconnect_warning(&app.dialog);
-  layer_add_child(root_layer, app.dialog.layer);
-  layer_set_hidden(app.dialog.layer, bp_get_status());
 }
 
 static void on_unload_window(Window *window) {
-  text_layer_destroy(app.title_layer);
-  gpath_destroy(app.indicator_path);
-  layer_destroy(app.meter_layer);
-
-  gbitmap_destroy(app.res_bmp_context);
-  bitmap_layer_destroy(app.bmp_context_layer);
-  text_layer_destroy(app.context_type_layer);
-
-  dialog_destroy(&app.dialog);
+  sensismart_bitmap_release(app.res_bmp_context);
+  sensismart_ui_release(&AppThermalContext);
 
   window_destroy(app.window);
 }
 
-static void on_processed_values(float t_skin, float t_feellike,
-                                float t_apparent, float t_humidex) {
-  app.current_humidex = t_humidex;
+static void on_processed_values(int32_t t_skin, int32_t t_feellike,
+                                int32_t t_apparent, int32_t t_humidex) {
+  app.current_humidex = round_milli(t_humidex, 1);
   layer_mark_dirty(app.meter_layer);
 }
 
 static void toggle_context() {
   app.current_context_idx = (app.current_context_idx + 1) % NUM_CONTEXTS;
 
-  gbitmap_destroy(app.res_bmp_context);
-
-  app.res_bmp_context = gbitmap_create_with_resource(CONTEXT_RESOURCES[app.current_context_idx]);
+  sensismart_bitmap_release(app.res_bmp_context);
+  app.res_bmp_context = sensismart_bitmap_acquire(CONTEXT_RESOURCES[app.current_context_idx]);
   bitmap_layer_set_bitmap(app.bmp_context_layer, app.res_bmp_context);
   text_layer_set_text(app.context_type_layer, CONTEXT_TITLES[app.current_context_idx]);
 }
@@ -191,8 +200,9 @@ static void on_click_select(ClickRecognizerRef recognizer, void *context) {
 }
 
 static void on_long_click_select(ClickRecognizerRef recognizer, void *context) {
-  CONTEXT_RANGES[app.current_context_idx].min = app.current_humidex - 20;
-  CONTEXT_RANGES[app.current_context_idx].max = app.current_humidex + 20;
+  CONTEXT_RANGES[app.current_context_idx].min = app.current_humidex / 10 - 20;
+  CONTEXT_RANGES[app.current_context_idx].max = app.current_humidex / 10 + 20;
+  update_angle_lut(app.current_context_idx);
   layer_mark_dirty(app.meter_layer);
 }
 
@@ -205,7 +215,7 @@ static void click_config_provider(Window *window) {
 static void init_bp_subscriptions() {
   bp_subscribe((BackpackHandlers) {
     .on_connection_state_changed = on_connection_state_changed,
-    .on_processed_values = on_processed_values
+    .on_processed_values_milli = on_processed_values
   });
 }
 
@@ -226,10 +236,24 @@ static void deactivate() {
   bp_unsubscribe();
 }
 
+static void load() {
+  for (int i = 0; i < NUM_CONTEXTS; ++i)
+    update_angle_lut(i);
+}
+
+static void prefetch() {
+  bp_prefetch((BackpackHandlers) {
+    .on_processed_values_milli = on_processed_values
+  });
+}
+
 SensiSmartApp AppThermalContext = {
   .name = "ThermalContext",
   .window = NULL,
+  .load = load,
   .activate = activate,
-  .deactivate = deactivate
+  .deactivate = deactivate,
+  .prefetch = prefetch,
+  .max_ui_objects = 5
 };
 
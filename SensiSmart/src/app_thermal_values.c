@@ -42,7 +42,7 @@ static const char LABEL_FEELS_LIKE_TEXT[] = "feels like";
 static const char EMPTY_VALUE_TEXT[] = "-";
 static const char CONNECTED_TEXT[] = "Connected!";
 static const char CONNECTING_TEXT[] = "Connecting...";
-static const char TEMPERATURE_FORMAT[] = "%s °C";
+static const char TEMPERATURE_UNIT[] = " °C";
 static const char UNKNOWN_COMPENSATION_MODE_NAME[] = "unknown";
 static const char THERMAL_VALUES_TITLE[] = "Thermal Values";
 
@@ -63,19 +63,17 @@ static struct {
   TextLayer *skin_label_text_layer;
   TextLayer *feel_like_label_text_layer;
   TextLayer *mode_name_text_layer;
-  char skin_text_layer_buf[20];
-  char feel_like_text_layer_buf[20];
+  ValueDisplay skin_display;
+  ValueDisplay feel_like_display;
   uint8_t current_compensation_mode;
   uint8_t number_of_compensation_modes;
   GBitmap *res_bmp_logo_black;
   BitmapLayer *bmp_logo_black_layer;
-  Dialog dialog;
+  /** latest processed values in milli-degrees, shown by render() */
+  int32_t t_skin;
+  int32_t t_feellike;
 } app;
 
-static void update_connection_text(bool connected) {
-  layer_set_hidden(app.dialog.layer, connected);
-}
-
 static const char *current_compensation_mode_name() {
   if (app.current_compensation_mode < NUMBER_OF_COMPENSATION_MODES)
     return COMPENSATION_MODE_NAMES[app.current_compensation_mode];
@@ -89,7 +87,8 @@ static void on_load_window(Window *window) {
   GFont gothic_28 = fonts_get_system_font(FONT_KEY_GOTHIC_28);
 
   // Screen Title
-  app.title_layer = text_layer_create(GRect(0, 0, 144, 20));
+  app.title_layer = sensismart_text_layer_create(&AppThermalValues,
+                                                 GRect(0, 0, 144, 20));
   text_layer_set_font(app.title_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18));
   text_layer_set_text(app.title_layer, THERMAL_VALUES_TITLE);
   text_layer_set_text_color(app.title_layer, GColorWhite);
@@ -97,7 +96,8 @@ static void on_load_window(Window *window) {
   text_layer_set_text_alignment(app.title_layer, GTextAlignmentCenter);
   layer_add_child(root_layer, text_layer_get_layer(app.title_layer));
 
-  app.skin_label_text_layer = text_layer_create(GRect(0, 28, 60, 40));
+  app.skin_label_text_layer = sensismart_text_layer_create(&AppThermalValues,
+                                                           GRect(0, 28, 60, 40));
   text_layer_set_font(app.skin_label_text_layer, gothic_24);
   text_layer_set_text(app.skin_label_text_layer, LABEL_SKIN_TEXT);
   text_layer_set_text_color(app.skin_label_text_layer, GColorWhite);
@@ -105,15 +105,19 @@ static void on_load_window(Window *window) {
   text_layer_set_background_color(app.skin_label_text_layer, GColorBlack);
   layer_add_child(root_layer, text_layer_get_layer(app.skin_label_text_layer));
 
-  app.skin_text_layer = text_layer_create(GRect(65, 28, 75, 40));
+  app.skin_text_layer = sensismart_text_layer_create(&AppThermalValues,
+                                                     GRect(65, 28, 75, 40));
   text_layer_set_font(app.skin_text_layer, gothic_28);
   text_layer_set_text(app.skin_text_layer, EMPTY_VALUE_TEXT);
   text_layer_set_text_color(app.skin_text_layer, GColorBrightGreen);
   text_layer_set_text_alignment(app.skin_text_layer, GTextAlignmentRight);
   text_layer_set_background_color(app.skin_text_layer, GColorBlack);
   layer_add_child(root_layer, text_layer_get_layer(app.skin_text_layer));
+  value_display_init(&app.skin_display, app.skin_text_layer, NULL,
+                     TEMPERATURE_UNIT, 1);
 
-  app.feel_like_label_text_layer = text_layer_create(GRect(0, 60, 60, 40));
+  app.feel_like_label_text_layer = sensismart_text_layer_create(&AppThermalValues,
+                                                                GRect(0, 60, 60, 40));
   text_layer_set_font(app.feel_like_label_text_layer, gothic_24);
   text_layer_set_text(app.feel_like_label_text_layer, LABEL_FEELS_LIKE_TEXT);
   text_layer_set_text_color(app.feel_like_label_text_layer, GColorWhite);
@@ -121,15 +125,19 @@ static void on_load_window(Window *window) {
   text_layer_set_background_color(app.feel_like_label_text_layer, GColorBlack);
   layer_add_child(root_layer, text_layer_get_layer(app.feel_like_label_text_layer));
 
-  app.feel_like_text_layer = text_layer_create(GRect(65, 60, 75, 40));
+  app.feel_like_text_layer = sensismart_text_layer_create(&AppThermalValues,
+                                                          GRect(65, 60, 75, 40));
   text_layer_set_font(app.feel_like_text_layer, gothic_28);
   text_layer_set_text(app.feel_like_text_layer, EMPTY_VALUE_TEXT);
   text_layer_set_text_color(app.feel_like_text_layer, GColorBrightGreen);
   text_layer_set_text_alignment(app.feel_like_text_layer, GTextAlignmentRight);
   text_layer_set_background_color(app.feel_like_text_layer, GColorBlack);
   layer_add_child(root_layer, text_layer_get_layer(app.feel_like_text_layer));
+  value_display_init(&app.feel_like_display, app.feel_like_text_layer,
+                     NULL, TEMPERATURE_UNIT, 1);
 
-  app.mode_name_text_layer = text_layer_create(GRect(0, 94, 144, 40));
+  app.mode_name_text_layer = sensismart_text_layer_create(&AppThermalValues,
+                                                          GRect(0, 94, 144, 40));
   text_layer_set_font(app.mode_name_text_layer, gothic_24);
   text_layer_set_text(app.mode_name_text_layer, current_compensation_mode_name());
   text_layer_set_text_color(app.mode_name_text_layer, GColorWhite);
@@ -138,45 +146,32 @@ static void on_load_window(Window *window) {
   layer_add_child(root_layer, text_layer_get_layer(app.mode_name_text_layer));
 
   // Sensirion Logo
-  app.res_bmp_logo_black = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_LOGO_BLACK);
-  app.bmp_logo_black_layer = bitmap_layer_create(GRect(7, 135, 131, 23));
+  app.res_bmp_logo_black = sensismart_bitmap_acquire(RESOURCE_ID_IMAGE_LOGO_BLACK);
+  app.bmp_logo_black_layer = sensismart_bitmap_layer_create(&AppThermalValues,
+                                                            GRect(7, 135, 131, 23));
   bitmap_layer_set_bitmap(app.bmp_logo_black_layer, app.res_bmp_logo_black);
   layer_add_child(root_layer, (Layer *)app.bmp_logo_black_layer);
-
-  // Dialog Box for Disconnect Events
-  dialog_create_disconnect_warning(&app.dialog);
-  layer_add_child(root_layer, app.dialog.layer);
-  layer_set_hidden(app.dialog.layer, bp_get_status());
 }
 
 static void on_unload_window(Window *window) {
-  text_layer_destroy(app.title_layer);
-  text_layer_destroy(app.skin_text_layer);
-  text_layer_destroy(app.feel_like_text_layer);
-  text_layer_destroy(app.skin_label_text_layer);
-  text_layer_destroy(app.feel_like_label_text_layer);
-  text_layer_destroy(app.mode_name_text_layer);
-  gbitmap_destroy(app.res_bmp_logo_black);
-  bitmap_layer_destroy(app.bmp_logo_black_layer);
-  dialog_destroy(&app.dialog);
+  sensismart_ui_release(&AppThermalValues);
+  sensismart_bitmap_release(app.res_bmp_logo_black);
   window_destroy(app.window);
 }
 
-static void on_processed_values(float t_skin, float t_feellike,
-                                float t_apparent, float t_humidex) {
-  char fbuf[16];
-
+static void render() {
   /* skin temperature */
-  ftoa(fbuf, t_skin, 1);
-  snprintf(app.skin_text_layer_buf, sizeof(app.skin_text_layer_buf),
-           TEMPERATURE_FORMAT, fbuf);
-  text_layer_set_text(app.skin_text_layer, app.skin_text_layer_buf);
+  value_display_set_milli(&app.skin_display, app.t_skin);
 
   /* feellike temperature */
-  ftoa(fbuf, t_feellike, 1);
-  snprintf(app.feel_like_text_layer_buf, sizeof(app.feel_like_text_layer_buf),
-           TEMPERATURE_FORMAT, fbuf);
-  text_layer_set_text(app.feel_like_text_layer, app.feel_like_text_layer_buf);
+  value_display_set_milli(&app.feel_like_display, app.t_feellike);
+}
+
+static void on_processed_values(int32_t t_skin, int32_t t_feellike,
+                                int32_t t_apparent, int32_t t_humidex) {
+  app.t_skin = t_skin;
+  app.t_feellike = t_feellike;
+  sensismart_request_render(&AppThermalValues);
 }
 
 void on_compensation_mode_changed(uint8_t mode, uint8_t num_modes) {
@@ -187,7 +182,6 @@ void on_compensation_mode_changed(uint8_t mode, uint8_t num_modes) {
 }
 
 static void on_connection_state_changed(bool connected) {
-  update_connection_text(connected);
   if (connected) {
       bp_set_temperature_compensation_mode(app.current_compensation_mode,
                                            on_compensation_mode_changed);
@@ -225,7 +219,7 @@ static void activate() {
   window_set_click_config_provider(app.window, (ClickConfigProvider) click_config_provider);
   bp_subscribe((BackpackHandlers) {
     .on_connection_state_changed = on_connection_state_changed,
-    .on_processed_values = on_processed_values
+    .on_processed_values_milli = on_processed_values
   });
   window_stack_push(app.window, true);
 }
@@ -244,11 +238,20 @@ static void load() {
   }
 }
 
+static void prefetch() {
+  bp_prefetch((BackpackHandlers) {
+    .on_processed_values_milli = on_processed_values
+  });
+}
+
 SensiSmartApp AppThermalValues = {
   .name = "ThermalValues",
   .window = NULL,
   .activate = activate,
   .deactivate = deactivate,
+  .render = render,
   .load = load,
+  .prefetch = prefetch,
+  .max_ui_objects = 7
 };
 
@@ -50,9 +50,10 @@ static struct {
   TextLayer *cap_text_layer;
   char capabilities_buf[160];
   enum display_mode display_mode;
-  Dialog dialog;
 } app;
 
+static void click_config_provider(Window *window);
+
 static void update_capabilities() {
   char env_cap[3];
   char skin_cap[3];
@@ -128,17 +129,16 @@ static void update_display() {
 }
 
 static void on_connection_state_changed(bool connected) {
-  layer_set_hidden((Layer *)app.dialog.layer, connected);
   update_capabilities();
 }
 
 static void on_load_window(Window *window) {
-  sensismart_window_load(&AppVersion);
+  app.window = window;
+  window_set_click_config_provider(window, (ClickConfigProvider) click_config_provider);
   Layer *root_layer = window_get_root_layer(window);
   GFont font = fonts_get_system_font(FONT_KEY_GOTHIC_14);
-  bool connected = bp_get_status();
 
-  app.bp_lib_version_text_layer = text_layer_create(GRect(0, 5, 144, 16));
+  app.bp_lib_version_text_layer = sensismart_text_layer_create(&AppVersion, GRect(0, 5, 144, 16));
   text_layer_set_font(app.bp_lib_version_text_layer, font);
   text_layer_set_text(app.bp_lib_version_text_layer, "App lib " BACKPACK_LIB_VERSION);
   text_layer_set_text_color(app.bp_lib_version_text_layer, GColorWhite);
@@ -147,27 +147,18 @@ static void on_load_window(Window *window) {
   text_layer_set_overflow_mode(app.bp_lib_version_text_layer, GTextOverflowModeWordWrap);
   layer_add_child(root_layer, text_layer_get_layer(app.bp_lib_version_text_layer));
 
-  app.cap_text_layer = text_layer_create(GRect(0, 28, 144, 100));
+  app.cap_text_layer = sensismart_text_layer_create(&AppVersion, GRect(0, 28, 144, 100));
   text_layer_set_font(app.cap_text_layer, font);
   text_layer_set_text_color(app.cap_text_layer, GColorBrightGreen);
   text_layer_set_background_color(app.cap_text_layer, GColorBlack);
   text_layer_set_overflow_mode(app.cap_text_layer, GTextOverflowModeWordWrap);
-  update_capabilities();
   layer_add_child(root_layer, text_layer_get_layer(app.cap_text_layer));
 
   layer_add_child(root_layer, sensismart_get_branding_layer());
-
-  dialog_create_disconnect_warning(&app.dialog);
-  layer_add_child(root_layer, app.dialog.layer);
-  layer_set_hidden(app.dialog.layer, connected);
 }
 
 static void on_unload_window(Window *window) {
-  text_layer_destroy(app.bp_lib_version_text_layer);
-  text_layer_destroy(app.fw_version_text_layer);
-  text_layer_destroy(app.cap_text_layer);
-  dialog_destroy(&app.dialog);
-  window_destroy(app.window);
+  app.window = NULL;
 }
 
 static void on_click_select(ClickRecognizerRef recognizer, void *context) {
@@ -182,21 +173,13 @@ static void click_config_provider(Window *window) {
 
 static void activate() {
   app.display_mode = DISPLAY_MODE_VALUES;
-  AppVersion.window = window_create();
-  app.window = AppVersion.window;
-  window_set_window_handlers(app.window, (WindowHandlers) {
-    .load = on_load_window,
-    .unload = on_unload_window
-  });
-  window_set_click_config_provider(app.window, (ClickConfigProvider) click_config_provider);
   bp_subscribe((BackpackHandlers) {
     .on_connection_state_changed = on_connection_state_changed
   });
-  window_stack_push(app.window, true);
+  update_capabilities();
 }
 
 static void deactivate() {
-  window_stack_pop(true);
   bp_unsubscribe();
 }
 
@@ -204,6 +187,9 @@ SensiSmartApp AppVersion = {
   .name = "Version",
   .window = NULL,
   .activate = activate,
-  .deactivate = deactivate
+  .deactivate = deactivate,
+  .window_load = on_load_window,
+  .window_unload = on_unload_window,
+  .max_ui_objects = 2
 };
 
@@ -32,17 +32,69 @@
 
 #include <pebble.h>
 #include "backpack.h"
+#include "scheduler.h"
+#include "startup.h"
 #include "utils.h"
 
 static const int DELAY_POLL_INTERVAL_MS   = 10;
 static const int LOGGER_CHECK_INTERVAL_MS = 60000;
+static const int LOG_CLEAR_CHECK_INTERVAL_MS = 1000;
+static const int LOG_SESSIONS_READ_DELAY_MS = 200;
+static const uint32_t LOG_INTERVAL_MS     = 100;
+static const int LOG_DOWNLOAD_RETRY_DELAY_MS = 100;
+static const int LOG_DOWNLOAD_MAX_RETRIES = 3;
+static const uint8_t LOG_DOWNLOAD_ALL_SESSIONS = 0xff;
+
+static const int PREFETCH_START_DELAY_MS = 250;
+
+/* Delays the background timers may run late to share a wakeup */
+static const uint32_t PREFETCH_SLACK_MS = 500;
+static const uint32_t LOG_WATCHDOG_SLACK_MS = 5000;
+static const uint32_t LOG_CLEAR_CHECK_SLACK_MS = 250;
+static const uint32_t LOG_SESSIONS_READ_SLACK_MS = 100;
 
 static uint32_t polling_interval_ms       = DEFAULT_POLL_INTERVAL_MS;
+static uint32_t prefetch_interval_ms      = DEFAULT_PREFETCH_INTERVAL_MS;
 static enum bp_log_status log_status      = STATUS_LOG_DIRTY;
+static enum bp_logger_state logger_state  = LOGGER_STATE_UNKNOWN;
+static bool log_wrap_around               = false;
+static struct bp_log_session log_sessions[BP_LOG_MAX_SESSIONS];
+static int num_log_sessions               = 0;
+static bool log_sessions_supported        = false;
+static uint64_t next_poll_ms              = 0;
+/** set by bp_start_polling(), the polling runs while connected */
+static bool polling                       = false;
+
+/* Bulk log transfer, scheduled around the live polling */
+static struct {
+  LogDownloadHandler handler;
+  SchedTimer timer;
+  uint64_t read_start_ms;
+  /** moving average of the bulk read duration, used to fit reads between polls */
+  uint32_t read_duration_ms;
+  uint32_t bytes;
+  /** share of the link used by the transfer in percent */
+  uint8_t share;
+  uint8_t retries;
+  /** the transfer yields to the live polling */
+  bool wait_for_poll;
+  /** the live reads of a poll just completed, the next read is always issued */
+  bool after_poll;
+  /** the receiver cannot take more data for now */
+  bool paused;
+} log_download = {
+  .share = 100
+};
 static time_t log_clear_time_end;
-static AppTimer *polling_timer            = NULL;
-static AppTimer *log_watchdog_timer       = NULL;
+static SchedTimer polling_timer           = SCHED_TIMER_NONE;
+static SchedTimer log_watchdog_timer      = SCHED_TIMER_NONE;
+static SchedTimer log_clear_timer         = SCHED_TIMER_NONE;
+static SchedTimer log_sessions_timer      = SCHED_TIMER_NONE;
+static SchedTimer prefetch_timer          = SCHED_TIMER_NONE;
+static SchedTimer replay_timer            = SCHED_TIMER_NONE;
 static volatile int open_reads            = 0;
+/** age of the value passed to the handlers, nonzero while replaying */
+static uint32_t value_age_ms              = 0;
 static uint32_t logged_values_mask        = 0x00000000;
 static uint16_t available_sensor_readings_mask  = 0x0000;
 static uint16_t available_processed_values_mask = 0x0000;
@@ -68,6 +120,7 @@ struct log_start_msg {
 };
 
 #define MAX_SUBSCRIBED_ATTRIBUTES 32
+#define MAX_PREFETCH_ATTRIBUTES 8
 
 struct BackpackAttribute at_sensor_readings;
 struct BackpackAttribute at_processed_values;
@@ -76,6 +129,12 @@ struct BackpackAttribute at_logger_start;
 struct BackpackAttribute at_logger_pause;
 struct BackpackAttribute at_logger_resume;
 struct BackpackAttribute at_logger_state;
+struct BackpackAttribute at_logger_wrap_around;
+struct BackpackAttribute at_logger_sessions;
+struct BackpackAttribute at_logger_session_new;
+struct BackpackAttribute at_logger_session_delete;
+struct BackpackAttribute at_logger_session_select;
+struct BackpackAttribute at_logger_entries;
 struct BackpackAttribute at_temperature_compensation_mode;
 struct BackpackAttribute at_airtouch_start_event;
 struct BackpackAttribute at_airtouch_stop_event;
@@ -88,35 +147,32 @@ struct BackpackAttribute at_system_available_sensor_readings;
 struct BackpackAttribute at_system_available_processed_values;
 struct BackpackAttribute at_system_version;
 
-/**
- * CAUTION! Keep in sync with pebble firmware!
- */
-enum fw_logger_state {
-    EMPTY,
-    DIRTY,
-    ERASING,
-    WRITING,
-    WRITING_PAUSED,
-    LOG_FULL, // log full
-    READING,
-    READING_FINISHED, // everything read
-};
-
 static int num_attributes = 0;
 static int num_subscribed_attributes = 0;
 static struct BackpackAttribute *attributes[MAX_SUBSCRIBED_ATTRIBUTES] = {NULL};
 static struct BackpackAttribute *subscribed_attributes[MAX_SUBSCRIBED_ATTRIBUTES];
+static int num_prefetch_attributes = 0;
+static struct BackpackAttribute *prefetch_attributes[MAX_PREFETCH_ATTRIBUTES];
 
 static BackpackHandlers bp_handlers;
 static TemperatureCompensationModeHandler temperature_compensation_mode_handler = NULL;
 static LogInterruptHandler log_interrupt_handler = NULL;
+static ConnectionStateHandler connection_state_observer = NULL;
 
 /* Forward declarations */
 void check_log_state();
 void log_watchdog_timer_fired();
+void cancel_log_watchdog();
+static void cancel_log_clear_check();
+static void schedule_log_clear_check();
+static void schedule_log_sessions_read();
+static void log_download_finish(enum bp_log_download_event event);
+static void log_download_read_failed();
+static void log_download_kick();
 static void on_battery_state_changed(BatteryChargeState charge);
 static void timer_resume();
 static void timer_suspend();
+static void schedule_replay();
 
 static void at_subscribe(struct BackpackAttribute *at) {
   if (num_subscribed_attributes>=MAX_SUBSCRIBED_ATTRIBUTES) {
@@ -124,6 +180,27 @@ static void at_subscribe(struct BackpackAttribute *at) {
     return;
   }
   subscribed_attributes[num_subscribed_attributes++] = at;
+  if (at->cache_time_ms)
+    schedule_replay();
+}
+
+static bool at_is_subscribed(struct BackpackAttribute *at) {
+  for (int i = 0; i < num_subscribed_attributes; ++i) {
+    if (subscribed_attributes[i] == at)
+      return true;
+  }
+  return false;
+}
+
+/* Remove an attribute from a list of attributes, keeping the order */
+static void at_list_remove(struct BackpackAttribute **list, int *len,
+                           struct BackpackAttribute *at) {
+  int j = 0;
+  for (int i = 0; i < *len; ++i) {
+    if (list[i] != at)
+      list[j++] = list[i];
+  }
+  *len = j;
 }
 
 static void at_unsubscribe_all() {
@@ -131,6 +208,22 @@ static void at_unsubscribe_all() {
   open_reads = 0;
 }
 
+static void at_cache(struct BackpackAttribute *at, const uint8_t *data,
+                     size_t length) {
+  if (!at->cache || length > at->len)
+    return;
+  memcpy(at->cache, data, length);
+  at->cache_len = length;
+  at->cache_time_ms = time_now_ms();
+}
+
+static void at_invalidate_caches() {
+  for (int i = 0; i < num_attributes; ++i) {
+    if (attributes[i])
+      attributes[i]->cache_time_ms = 0;
+  }
+}
+
 static void at_read(struct BackpackAttribute *at) {
   if (at->open_read) {
     ERR("at_read: attribute %s: still waiting on last read, discarding", at->desc);
@@ -139,6 +232,7 @@ static void at_read(struct BackpackAttribute *at) {
   if (smartstrap_attribute_read(at->attribute) == SmartstrapResultOk) {
     open_reads += 1;
     at->open_read = true;
+    at->prefetch_read = false;
   } else {
     ERR("at_read: attribute %s cannot be read", at->desc);
   }
@@ -176,7 +270,13 @@ static bool at_handle_read(struct BackpackAttribute *at, const uint8_t *data,
   if (at->attribute != attr)
     return false;
   at->open_read = false;
-  if (at->handler)
+  at_cache(at, data, length);
+  /* prefetched values are only reported once subscribed */
+  bool prefetch_read = at->prefetch_read;
+  at->prefetch_read = false;
+  if (!prefetch_read && at_is_subscribed(at))
+    startup_mark(STARTUP_FIRST_POLL);
+  if (at->handler && (!prefetch_read || at_is_subscribed(at)))
     at->handler(data, length, smartstrap_attribute_get_attribute_id(at->attribute));
   return true;
 }
@@ -186,11 +286,16 @@ static void at_init(struct BackpackAttribute *attribute,
                     SmartstrapAttributeId attribute_id,
                     size_t len, const char *desc,
                     BackpackAttributeHandler handler) {
+  /* reuse the slot of a destroyed attribute, e.g. of an unloaded screen */
+  int id = 0;
+  while (id < num_attributes && attributes[id])
+    ++id;
   *attribute = (struct BackpackAttribute) {
     .attribute = smartstrap_attribute_create(service_id, attribute_id, len),
     .desc = desc,
     .handler = handler,
-    .id = num_attributes++,
+    .id = id,
+    .len = len,
     .open_read = false
   };
   if (attribute->id >= MAX_SUBSCRIBED_ATTRIBUTES) {
@@ -198,6 +303,8 @@ static void at_init(struct BackpackAttribute *attribute,
     return;
   }
   attributes[attribute->id] = attribute;
+  if (id == num_attributes)
+    num_attributes += 1;
 }
 
 static void at_destroy(struct BackpackAttribute *at) {
@@ -207,6 +314,14 @@ static void at_destroy(struct BackpackAttribute *at) {
     smartstrap_attribute_destroy(at->attribute);
     at->attribute = NULL;
   }
+  /* the polling and the prefetching must not read it anymore */
+  at_list_remove(subscribed_attributes, &num_subscribed_attributes, at);
+  at_list_remove(prefetch_attributes, &num_prefetch_attributes, at);
+  free(at->cache);
+  at->cache = NULL;
+  at->cache_time_ms = 0;
+  if (at->id < MAX_SUBSCRIBED_ATTRIBUTES && attributes[at->id] == at)
+    attributes[at->id] = NULL;
 }
 
 bool bp_destroy_attribute(struct BackpackAttribute *at) {
@@ -228,6 +343,15 @@ bool bp_readval(const uint8_t *data, size_t len, int *offset, void *result,
   return true;
 }
 
+bool bp_readval_milli(const uint8_t *data, size_t len, int *offset,
+                      int32_t *result, const char *desc) {
+  uint32_t bits;
+  if (!bp_readval(data, len, offset, &bits, sizeof(bits), desc))
+    return false;
+  *result = float_bits_to_milli(bits);
+  return true;
+}
+
 static void process_sensor_readings(const uint8_t *data, size_t length,
                                     SmartstrapAttributeId attribute_id) {
   int32_t t_c     = 0;
@@ -267,8 +391,34 @@ static void process_sensor_readings(const uint8_t *data, size_t length,
       bp_handlers.on_sensor_readings(t_c, rh, t_skin, reserved0, reserved1);
 }
 
+static void process_processed_values_milli(const uint8_t *data, size_t length,
+                                           SmartstrapAttributeId attribute_id) {
+  int32_t t_skin = 0;
+  int32_t t_feellike = 0;
+  int32_t t_apparent = 0;
+  int32_t t_humidex = 0;
+  int offset = 0;
+
+  if (attribute_id & ATTR_PROCESSED_VALUES_SKIN_TEMPERATURE)
+    bp_readval_milli(data, length, &offset, &t_skin, "skin temperature");
+  if (attribute_id & ATTR_PROCESSED_VALUES_FEELLIKE_TEMPERATURE)
+    bp_readval_milli(data, length, &offset, &t_feellike, "feellike temperature");
+  if (attribute_id & ATTR_PROCESSED_VALUES_APPARENT_TEMPERATURE)
+    bp_readval_milli(data, length, &offset, &t_apparent, "apparent temperature");
+  if (attribute_id & ATTR_PROCESSED_VALUES_HUMIDEX)
+    bp_readval_milli(data, length, &offset, &t_humidex, "humidex temperature");
+
+  bp_handlers.on_processed_values_milli(t_skin, t_feellike, t_apparent,
+                                        t_humidex);
+}
+
 static void process_processed_values(const uint8_t *data, size_t length,
                                      SmartstrapAttributeId attribute_id) {
+  if (bp_handlers.on_processed_values_milli) {
+    process_processed_values_milli(data, length, attribute_id);
+    return;
+  }
+
   float t_skin;
   float t_feellike;
   float t_apparent;
@@ -325,8 +475,8 @@ static void set_initialized_state(enum init_state_flags new_init_state) {
   if (new_init_state == UNINITIALIZED) {
     init_state = UNINITIALIZED;
     logged_values_mask = 0x00000000;
-    if (polling_timer)
-      timer_suspend();
+    at_invalidate_caches();
+    timer_suspend();
   } else {
     init_state |= new_init_state;
   }
@@ -352,12 +502,14 @@ static void set_initialized_state(enum init_state_flags new_init_state) {
       )
     );
 
-    if (polling_timer)
+    if (polling)
       timer_resume();
   }
 
-  if (bp_handlers.on_connection_state_changed) {
-    if (init_state == UNINITIALIZED || initialized)
+  if (init_state == UNINITIALIZED || initialized) {
+    if (connection_state_observer)
+      connection_state_observer(initialized);
+    if (bp_handlers.on_connection_state_changed)
       bp_handlers.on_connection_state_changed(initialized);
   }
 }
@@ -373,6 +525,8 @@ static void on_connection_state_changed(bool connected) {
     on_battery_state_changed(charge);
   } else {
     set_initialized_state(UNINITIALIZED);
+    if (log_download.handler)
+      log_download_finish(LOG_DOWNLOAD_FAILED);
     bp_firmware_version[0] = '\0';
     available_sensor_readings_mask = 0x0000;
     available_processed_values_mask = 0x0000;
@@ -389,6 +543,9 @@ static void on_did_read(SmartstrapAttribute *attr, SmartstrapResult result,
     ERR("read %db from %04x:%04x failed (result %d)",
         length, service_id, attribute_id, result);
     reset_attribute_read_state(attr);
+    if (attr == at_logger_entries.attribute)
+      log_download_read_failed();
+    log_download_kick();
     return;
   }
   DBG("read %db from %04x:%04x", length, service_id, attribute_id);
@@ -404,6 +561,7 @@ static void on_did_read(SmartstrapAttribute *attr, SmartstrapResult result,
     WARN("read %db from unknown service %04x:%04x",
          length, service_id, attribute_id);
   }
+  log_download_kick();
 }
 
 static void on_did_write(SmartstrapAttribute *attr, SmartstrapResult result) {
@@ -427,21 +585,184 @@ static void send_request_loop(void *context) {
     at_read(subscribed_attributes[i]);
   }
 
-  polling_timer = app_timer_register(polling_interval_ms, send_request_loop,
-                                     context);
+  polling_timer = sched_register(polling_interval_ms, 0, send_request_loop,
+                                 context);
+  next_poll_ms = time_now_ms() + polling_interval_ms;
 }
 
 static void timer_suspend() {
   if (!polling_timer)
     return;
-  app_timer_cancel(polling_timer);
-  polling_timer = NULL;
+  sched_cancel(polling_timer);
+  polling_timer = SCHED_TIMER_NONE;
+  next_poll_ms = 0;
+  log_download_kick();
 }
 
 static void timer_resume() {
   if (num_subscribed_attributes == 0 || polling_timer)
     return;
-  polling_timer = app_timer_register(0, send_request_loop, NULL);
+  polling_timer = sched_register(0, 0, send_request_loop, NULL);
+  next_poll_ms = time_now_ms();
+}
+
+/*
+ * Prefetching
+ * Attributes of screens that are likely shown next are read at a low rate
+ * into their cache. The cached values are replayed when the attributes are
+ * subscribed, unless they are older than two prefetch intervals.
+ */
+static void prefetch_loop(void *context) {
+  prefetch_timer = sched_register(prefetch_interval_ms, PREFETCH_SLACK_MS,
+                                  prefetch_loop, NULL);
+  if (!bp_get_status())
+    return;
+  for (int i = 0; i < num_prefetch_attributes; ++i) {
+    struct BackpackAttribute *at = prefetch_attributes[i];
+    /* subscribed attributes are kept current by the polling */
+    if (at->open_read || at_is_subscribed(at))
+      continue;
+    at_read(at);
+    at->prefetch_read = at->open_read;
+  }
+}
+
+static void replay_cached_values(void *context) {
+  replay_timer = SCHED_TIMER_NONE;
+  uint64_t now = time_now_ms();
+  for (int i = 0; i < num_subscribed_attributes; ++i) {
+    struct BackpackAttribute *at = subscribed_attributes[i];
+    if (!at->handler || !at->cache_time_ms ||
+        now - at->cache_time_ms > 2 * prefetch_interval_ms)
+      continue;
+    DBG("Replaying cached %s", at->desc);
+    /* a value read just now would still count as replayed */
+    value_age_ms = (uint32_t) (now - at->cache_time_ms) + 1;
+    at->handler(at->cache, at->cache_len,
+                smartstrap_attribute_get_attribute_id(at->attribute));
+    value_age_ms = 0;
+  }
+}
+
+uint32_t bp_get_value_age_ms() {
+  return value_age_ms;
+}
+
+static void schedule_replay() {
+  /* defer the replay until the subscriber is set up completely */
+  if (!replay_timer)
+    replay_timer = sched_register(0, 0, replay_cached_values, NULL);
+}
+
+static void cancel_replay() {
+  if (replay_timer) {
+    sched_cancel(replay_timer);
+    replay_timer = SCHED_TIMER_NONE;
+  }
+}
+
+/*
+ * Link scheduling
+ * The live polling has priority over the bulk log transfer: a bulk read is
+ * only issued when no live read is pending and the read is expected to
+ * complete before the next poll is due. Otherwise the transfer waits until the
+ * live reads completed, so the polling rate is never reduced by a download.
+ * Between reads, the transfer idles such that it uses at most its configured
+ * share of the link.
+ */
+static int live_open_reads() {
+  /* open_reads is reset when unsubscribing */
+  int live_reads = open_reads - (at_logger_entries.open_read ? 1 : 0);
+  return live_reads > 0 ? live_reads : 0;
+}
+
+static void log_download_issue(void *context);
+
+static void log_download_schedule(uint32_t delay_ms) {
+  if (log_download.timer)
+    return;
+  log_download.timer = sched_register(delay_ms, 0, log_download_issue, NULL);
+}
+
+static void log_download_issue(void *context) {
+  log_download.timer = SCHED_TIMER_NONE;
+  if (!log_download.handler || log_download.paused ||
+      at_logger_entries.open_read)
+    return;
+
+  /*
+   * Right after a poll a read is issued even if it may not fit, otherwise an
+   * overestimated duration would stall the transfer and never be refreshed
+   */
+  uint64_t now = time_now_ms();
+  bool after_poll = log_download.after_poll;
+  log_download.after_poll = false;
+  if (live_open_reads() > 0 ||
+      (polling_timer && !after_poll &&
+       now + log_download.read_duration_ms >= next_poll_ms)) {
+    log_download.wait_for_poll = true;
+    return;
+  }
+  log_download.wait_for_poll = false;
+  log_download.read_start_ms = now;
+  at_read(&at_logger_entries);
+  if (!at_logger_entries.open_read)
+    log_download_read_failed();
+}
+
+/* Resume a bulk transfer that yielded to the live polling */
+static void log_download_kick() {
+  if (log_download.handler && log_download.wait_for_poll &&
+      live_open_reads() == 0) {
+    log_download.after_poll = true;
+    log_download_schedule(0);
+  }
+}
+
+static void log_download_finish(enum bp_log_download_event event) {
+  LogDownloadHandler handler = log_download.handler;
+  if (log_download.timer) {
+    sched_cancel(log_download.timer);
+    log_download.timer = SCHED_TIMER_NONE;
+  }
+  log_download.handler = NULL;
+  log_download.wait_for_poll = false;
+  if (handler)
+    handler(event, NULL, 0);
+}
+
+static void log_download_read_failed() {
+  if (!log_download.handler)
+    return;
+  if (++log_download.retries > LOG_DOWNLOAD_MAX_RETRIES) {
+    ERR("Log download failed after %u bytes", (unsigned) log_download.bytes);
+    log_download_finish(LOG_DOWNLOAD_FAILED);
+    return;
+  }
+  log_download_schedule(LOG_DOWNLOAD_RETRY_DELAY_MS);
+}
+
+static void on_log_entries_read(const uint8_t *data, size_t length,
+                                SmartstrapAttributeId id) {
+  if (!log_download.handler)
+    return;
+  uint32_t duration_ms = time_now_ms() - log_download.read_start_ms;
+  /* decay slow outliers, e.g. a read delayed by a poll */
+  log_download.read_duration_ms = log_download.read_duration_ms ?
+      (3 * log_download.read_duration_ms + duration_ms) / 4 : duration_ms;
+  log_download.retries = 0;
+  if (length == 0) {
+    DBG("Log download finished (%u bytes)", (unsigned) log_download.bytes);
+    log_download_finish(LOG_DOWNLOAD_FINISHED);
+    return;
+  }
+  log_download.bytes += length;
+  log_download.handler(LOG_DOWNLOAD_DATA, data, length);
+  /* the handler may have cancelled the transfer */
+  if (log_download.handler) {
+    log_download_schedule(log_download.read_duration_ms *
+                          (100 - log_download.share) / log_download.share);
+  }
 }
 
 static void on_battery_state_changed(BatteryChargeState charge) {
@@ -462,8 +783,16 @@ static void on_availability_did_change(SmartstrapServiceId service_id,
   if (service_id == SERVICE_SYSTEM)
     on_connection_state_changed(is_available);
 
-  if (is_available && service_id == SERVICE_LOGGER)
+  if (!is_available && service_id == SERVICE_LOGGER) {
+    logger_state = LOGGER_STATE_UNKNOWN;
+    log_sessions_supported = false;
+    num_log_sessions = 0;
+  }
+
+  if (is_available && service_id == SERVICE_LOGGER) {
     check_log_state();
+    schedule_log_sessions_read();
+  }
 
   if (bp_handlers.availability_did_change)
     bp_handlers.availability_did_change(service_id, is_available);
@@ -534,28 +863,95 @@ static void on_notified(SmartstrapAttribute *attr) {
   }
 }
 
+static void update_log_status(enum bp_log_status status) {
+  if (status == log_status)
+    return;
+  /* a poll may still see the old data before the erase has begun, only the
+   * EMPTY state or the clear check timeout ends a pending clear */
+  if (status == STATUS_LOG_DIRTY && log_status == STATUS_LOG_CLEARING)
+    return;
+  log_status = status;
+  if (status != STATUS_LOG_CLEARING)
+    log_clear_time_end = 0;
+  if (log_interrupt_handler)
+    log_interrupt_handler();
+}
+
 static void on_logger_status_read(const uint8_t *data, size_t length,
                                   SmartstrapAttributeId id) {
-  switch (data[0]) {
-    case EMPTY:
+  if (length != ATTR_LOGGER_STATE_LEN) {
+    ERR("Logger state has length %d", length);
+    return;
+  }
+  logger_state = data[0];
+  switch (logger_state) {
+    case LOGGER_STATE_EMPTY:
       INFO("Log state; EMPTY");
-      log_status = STATUS_LOG_CLEARED;
-      log_clear_time_end = 0;
-      if (log_interrupt_handler)
-        log_interrupt_handler();
+      cancel_log_clear_check();
+      num_log_sessions = 0;
+      update_log_status(STATUS_LOG_CLEARED);
       break;
-    case DIRTY:
+    case LOGGER_STATE_DIRTY:
       INFO("Log state; DIRTY");
-      log_status = STATUS_LOG_DIRTY;
-      log_clear_time_end = 0;
-      if (log_interrupt_handler)
-        log_interrupt_handler();
+      update_log_status(STATUS_LOG_DIRTY);
+      break;
+    case LOGGER_STATE_ERASING:
+      DBG("Log state; ERASING");
+      if (log_status != STATUS_LOG_CLEARING) {
+        /* erase started elsewhere, e.g. before the app was restarted */
+        log_clear_time_end = time(NULL) + BP_LOG_CLEAR_TIME;
+        schedule_log_clear_check();
+        update_log_status(STATUS_LOG_CLEARING);
+      }
+      break;
+    case LOGGER_STATE_WRITING:
+      DBG("Log state; WRITING");
+      update_log_status(STATUS_LOG_STARTED);
+      break;
+    case LOGGER_STATE_WRITING_PAUSED:
+      DBG("Log state; WRITING_PAUSED");
+      update_log_status(STATUS_LOG_STOPPED);
+      break;
+    case LOGGER_STATE_LOG_FULL:
+      WARN("Log state; LOG_FULL%s",
+           log_wrap_around ? " (wrap-around not supported by backpack)" : "");
+      cancel_log_watchdog();
+      update_log_status(STATUS_LOG_FULL);
+      break;
+    case LOGGER_STATE_READING:
+    case LOGGER_STATE_READING_FINISHED:
+      DBG("Log state; READING%s",
+          logger_state == LOGGER_STATE_READING_FINISHED ? "_FINISHED" : "");
+      /* the log still holds data but is not being written to */
+      update_log_status(STATUS_LOG_DIRTY);
       break;
     default:
-      // ignore
+      ERR("Unknown log state %d", logger_state);
+      logger_state = LOGGER_STATE_UNKNOWN;
       break;
   }
-  set_initialized_state(READ_LOGGED_VALUES_MASK);
+  /* the state is polled while clearing, only report the connection once */
+  if (!(init_state & READ_LOGGED_VALUES_MASK))
+    set_initialized_state(READ_LOGGED_VALUES_MASK);
+}
+
+static void on_log_sessions_read(const uint8_t *data, size_t length,
+                                 SmartstrapAttributeId id) {
+  int offset = 0;
+  int i;
+  if (length % sizeof(struct bp_log_session)) {
+    ERR("Log session index has length %d", length);
+    return;
+  }
+  log_sessions_supported = true;
+  for (i = 0; i < BP_LOG_MAX_SESSIONS && offset < (int)length; ++i) {
+    bp_readval(data, length, &offset, &log_sessions[i],
+               sizeof(struct bp_log_session), "log session");
+  }
+  num_log_sessions = i;
+  DBG("Log holds %d sessions", num_log_sessions);
+  if (log_interrupt_handler)
+    log_interrupt_handler();
 }
 
 static void on_system_version_read(const uint8_t *data, size_t length,
@@ -643,6 +1039,24 @@ int bp_init() {
   at_init(&at_logger_resume, SERVICE_LOGGER, ATTR_LOGGER_RESUME,
           ATTR_LOGGER_RESUME_LEN, "Log resume", NULL);
   ret &= (at_logger_resume.attribute != NULL);
+  at_init(&at_logger_wrap_around, SERVICE_LOGGER, ATTR_LOGGER_WRAP_AROUND,
+          ATTR_LOGGER_WRAP_AROUND_LEN, "Log wrap-around", NULL);
+  ret &= (at_logger_wrap_around.attribute != NULL);
+  at_init(&at_logger_sessions, SERVICE_LOGGER, ATTR_LOGGER_SESSIONS,
+          ATTR_LOGGER_SESSIONS_LEN, "Log sessions", on_log_sessions_read);
+  ret &= (at_logger_sessions.attribute != NULL);
+  at_init(&at_logger_session_new, SERVICE_LOGGER, ATTR_LOGGER_SESSION_NEW,
+          ATTR_LOGGER_START_LEN, "Log new session", NULL);
+  ret &= (at_logger_session_new.attribute != NULL);
+  at_init(&at_logger_session_delete, SERVICE_LOGGER, ATTR_LOGGER_SESSION_DELETE,
+          ATTR_LOGGER_SESSION_DELETE_LEN, "Log delete session", NULL);
+  ret &= (at_logger_session_delete.attribute != NULL);
+  at_init(&at_logger_session_select, SERVICE_LOGGER, ATTR_LOGGER_SESSION_SELECT,
+          ATTR_LOGGER_SESSION_SELECT_LEN, "Log select session", NULL);
+  ret &= (at_logger_session_select.attribute != NULL);
+  at_init(&at_logger_entries, SERVICE_LOGGER, ATTR_LOGGER_ENTRIES,
+          ATTR_LOGGER_ENTRIES_MAX_LEN, "Log entries", on_log_entries_read);
+  ret &= (at_logger_entries.attribute != NULL);
 
   at_init(&at_airtouch_start_event, SERVICE_PROCESSED_VALUES,
           ATTR_PROCESSED_VALUES_AIRTOUCH_START_EVENT,
@@ -723,6 +1137,12 @@ static void cleanup_attributes(void *ctx) {
   at_destroy(&at_logger_start);
   at_destroy(&at_logger_pause);
   at_destroy(&at_logger_resume);
+  at_destroy(&at_logger_wrap_around);
+  at_destroy(&at_logger_sessions);
+  at_destroy(&at_logger_session_new);
+  at_destroy(&at_logger_session_delete);
+  at_destroy(&at_logger_session_select);
+  at_destroy(&at_logger_entries);
   at_destroy(&at_airtouch_start_event);
   at_destroy(&at_airtouch_stop_event);
   at_destroy(&at_onbody_event);
@@ -739,7 +1159,16 @@ static void cleanup_attributes(void *ctx) {
 
 void bp_deinit() {
   battery_state_service_unsubscribe();
+  bp_log_download_cancel();
   timer_suspend();
+  cancel_log_watchdog();
+  cancel_log_clear_check();
+  if (log_sessions_timer) {
+    sched_cancel(log_sessions_timer);
+    log_sessions_timer = SCHED_TIMER_NONE;
+  }
+  bp_prefetch_clear();
+  cancel_replay();
   cleanup_attributes(NULL);
   smartstrap_unsubscribe();
 }
@@ -764,12 +1193,11 @@ void bp_subscribe(BackpackHandlers handlers) {
   bp_handlers = handlers;
   if (handlers.on_sensor_readings)
     at_subscribe(&at_sensor_readings);
-  if (handlers.on_processed_values)
+  if (handlers.on_processed_values || handlers.on_processed_values_milli)
     at_subscribe(&at_processed_values);
   if (handlers.on_onbody_event)
     at_read(&at_onbody_state);
-  if (bp_get_status())
-    timer_resume();
+  bp_start_polling();
 }
 
 void bp_init_attribute(struct BackpackAttribute *attribute,
@@ -784,6 +1212,12 @@ void bp_subscribe_attribute(struct BackpackAttribute *at) {
   at_subscribe(at);
 }
 
+void bp_start_polling() {
+  polling = true;
+  if (bp_get_status())
+    timer_resume();
+}
+
 void bp_set_polling_interval(uint32_t interval_ms) {
   polling_interval_ms = interval_ms;
 }
@@ -791,7 +1225,9 @@ void bp_set_polling_interval(uint32_t interval_ms) {
 void bp_unsubscribe() {
   if (open_reads)
     DBG("Unsubscribing (%d open reads)", open_reads);
+  polling = false;
   timer_suspend();
+  cancel_replay();
   at_unsubscribe_all();
   bp_handlers = (BackpackHandlers) {
     .availability_did_change = NULL
@@ -800,40 +1236,122 @@ void bp_unsubscribe() {
   polling_interval_ms = DEFAULT_POLL_INTERVAL_MS;
 }
 
+void bp_prefetch_attribute(struct BackpackAttribute *at) {
+  for (int i = 0; i < num_prefetch_attributes; ++i) {
+    if (prefetch_attributes[i] == at)
+      return;
+  }
+  if (num_prefetch_attributes >= MAX_PREFETCH_ATTRIBUTES) {
+    ERR("No more space for attributes! Increase MAX_PREFETCH_ATTRIBUTES");
+    return;
+  }
+  /* the cache is kept until the attribute is destroyed */
+  if (!at->cache)
+    at->cache = malloc(at->len);
+  if (!at->cache) {
+    ERR("Cannot allocate cache for attribute %s", at->desc);
+    return;
+  }
+  prefetch_attributes[num_prefetch_attributes++] = at;
+  if (!prefetch_timer)
+    prefetch_timer = sched_register(PREFETCH_START_DELAY_MS, PREFETCH_SLACK_MS,
+                                    prefetch_loop, NULL);
+}
+
+void bp_prefetch(BackpackHandlers handlers) {
+  if (handlers.on_sensor_readings)
+    bp_prefetch_attribute(&at_sensor_readings);
+  if (handlers.on_processed_values || handlers.on_processed_values_milli)
+    bp_prefetch_attribute(&at_processed_values);
+}
+
+void bp_prefetch_clear() {
+  num_prefetch_attributes = 0;
+  if (prefetch_timer) {
+    sched_cancel(prefetch_timer);
+    prefetch_timer = SCHED_TIMER_NONE;
+  }
+}
+
+void bp_set_prefetch_interval(uint32_t interval_ms) {
+  prefetch_interval_ms = interval_ms;
+}
+
 time_t bp_log_remaining() {
-  if (log_status >= STATUS_LOG_CLEARED)
+  if (log_status != STATUS_LOG_CLEARING)
     return 0;
   time_t remaining = log_clear_time_end - time(NULL);
   if (remaining <= 0) {
     log_status = STATUS_LOG_CLEARED;
     remaining = 0;
-    DBG("Log clearing completed");
+    cancel_log_clear_check();
+    DBG("Log clearing timed out, assuming completed");
   }
   return remaining;
 }
 
 void cancel_log_watchdog() {
   if (log_watchdog_timer) {
-    app_timer_cancel(log_watchdog_timer);
-    log_watchdog_timer = NULL;
+    sched_cancel(log_watchdog_timer);
+    log_watchdog_timer = SCHED_TIMER_NONE;
   }
 }
 
 void schedule_log_watchdog() {
   if (log_watchdog_timer)
     cancel_log_watchdog();
-  log_watchdog_timer = app_timer_register(LOGGER_CHECK_INTERVAL_MS,
-                                          log_watchdog_timer_fired, NULL);
+  log_watchdog_timer = sched_register_periodic(LOGGER_CHECK_INTERVAL_MS,
+                                               LOG_WATCHDOG_SLACK_MS,
+                                               log_watchdog_timer_fired, NULL);
 }
 
 void check_log_state() {
   at_read(&at_logger_state);
 }
 
+static void cancel_log_clear_check() {
+  if (log_clear_timer) {
+    sched_cancel(log_clear_timer);
+    log_clear_timer = SCHED_TIMER_NONE;
+  }
+}
+
+static void log_clear_check_fired(void *context) {
+  if (log_status != STATUS_LOG_CLEARING) {
+    cancel_log_clear_check();
+    return;
+  }
+  if (init_state == INITIALIZED)
+    check_log_state();
+}
+
+static void log_sessions_read_fired(void *context) {
+  log_sessions_timer = SCHED_TIMER_NONE;
+  at_read(&at_logger_sessions);
+}
+
+/* Give the backpack time to process a preceding log command */
+static void schedule_log_sessions_read() {
+  if (log_sessions_timer)
+    return;
+  log_sessions_timer = sched_register(LOG_SESSIONS_READ_DELAY_MS,
+                                      LOG_SESSIONS_READ_SLACK_MS,
+                                      log_sessions_read_fired, NULL);
+}
+
+static void schedule_log_clear_check() {
+  cancel_log_clear_check();
+  log_clear_timer = sched_register_periodic(LOG_CLEAR_CHECK_INTERVAL_MS,
+                                            LOG_CLEAR_CHECK_SLACK_MS,
+                                            log_clear_check_fired, NULL);
+}
+
 void log_watchdog_timer_fired() {
-  log_watchdog_timer = NULL;
   check_log_state();
-  schedule_log_watchdog();
+}
+
+enum bp_logger_state bp_log_get_logger_state() {
+  return logger_state;
 }
 
 enum bp_log_status bp_log_get_status() {
@@ -846,6 +1364,10 @@ uint32_t bp_get_logged_values_mask() {
   return logged_values_mask;
 }
 
+uint32_t bp_log_get_interval_ms() {
+  return LOG_INTERVAL_MS;
+}
+
 time_t bp_log_clear() {
   cancel_log_watchdog();
 
@@ -861,12 +1383,18 @@ time_t bp_log_clear() {
   size_t buflen;
   smartstrap_attribute_begin_write(at_logger_clear.attribute, &buf, &buflen);
   smartstrap_attribute_end_write(at_logger_clear.attribute, ATTR_LOGGER_CLEAR_LEN, false);
+  schedule_log_clear_check();
   DBG("Log clearing started");
   return BP_LOG_CLEAR_TIME;
 }
 
+static void send_log_wrap_around() {
+  at_write(&at_logger_wrap_around, log_wrap_around, false);
+}
+
 static void bp_log_resume() {
   log_status = STATUS_LOG_STARTED;
+  send_log_wrap_around();
   uint8_t *buf;
   size_t buflen;
   smartstrap_attribute_begin_write(at_logger_resume.attribute, &buf, &buflen);
@@ -875,37 +1403,64 @@ static void bp_log_resume() {
   DBG("Logging resumed");
 }
 
+static bool write_log_start_msg(struct BackpackAttribute *at) {
+  struct log_start_msg *start_msg;
+  size_t buflen;
+  smartstrap_attribute_begin_write(at->attribute,
+                                   (uint8_t **)&start_msg, &buflen);
+  if (buflen < sizeof(struct log_start_msg)) {
+    ERR("Buffer for log start message too small");
+    smartstrap_attribute_end_write(at->attribute, 0, false);
+    return false;
+  }
+  time_t t;
+  uint16_t ms = time_ms(&t, NULL);
+  start_msg->start_time_ms = ((uint64_t) t) * 1000 + ms;
+  start_msg->log_interval_ms = LOG_INTERVAL_MS;
+  start_msg->enabled_channels_mask = logged_values_mask;
+  smartstrap_attribute_end_write(at->attribute,
+                                 sizeof(struct log_start_msg), false);
+  return true;
+}
+
 void bp_log_start() {
   schedule_log_watchdog();
 
   bp_log_remaining();
   if (log_status == STATUS_LOG_STOPPED) {
     bp_log_resume();
+    schedule_log_sessions_read();
     return;
   }
   if (log_status != STATUS_LOG_CLEARED)
     return;
-  struct log_start_msg *start_msg;
-  size_t buflen;
-  smartstrap_attribute_begin_write(at_logger_start.attribute,
-                                   (uint8_t **)&start_msg, &buflen);
-  if (buflen < sizeof(struct log_start_msg)) {
-    ERR("Buffer for log start message too small");
-    smartstrap_attribute_end_write(at_logger_start.attribute, 0, false);
+  send_log_wrap_around();
+  if (!write_log_start_msg(&at_logger_start))
     return;
-  }
   log_status = STATUS_LOG_STARTED;
-  time_t t;
-  uint16_t ms = time_ms(&t, NULL);
-  start_msg->start_time_ms = ((uint64_t) t) * 1000 + ms;
-  start_msg->log_interval_ms = 100;
-  start_msg->enabled_channels_mask = logged_values_mask;
-  smartstrap_attribute_end_write(at_logger_start.attribute,
-                                 sizeof(struct log_start_msg), false);
+  schedule_log_sessions_read();
   DBG("Logging started with mask 0x%04x%04x", (uint16_t)(logged_values_mask >> 16),
                                               (uint16_t)(logged_values_mask & 0xffff));
 }
 
+bool bp_log_new_session() {
+  if (!log_sessions_supported ||
+      (log_status != STATUS_LOG_DIRTY && log_status != STATUS_LOG_STOPPED))
+    return false;
+  if (num_log_sessions >= BP_LOG_MAX_SESSIONS) {
+    WARN("Log session index full, clear the log to start a new session");
+    return false;
+  }
+  schedule_log_watchdog();
+  send_log_wrap_around();
+  if (!write_log_start_msg(&at_logger_session_new))
+    return false;
+  log_status = STATUS_LOG_STARTED;
+  schedule_log_sessions_read();
+  DBG("Log session %d started", num_log_sessions + 1);
+  return true;
+}
+
 void bp_log_stop() {
   if (log_status != STATUS_LOG_STARTED)
     return;
@@ -915,9 +1470,110 @@ void bp_log_stop() {
   smartstrap_attribute_begin_write(at_logger_pause.attribute, &buf, &buflen);
   smartstrap_attribute_end_write(at_logger_pause.attribute,
                                  ATTR_LOGGER_PAUSE_LEN, false);
+  schedule_log_sessions_read();
   DBG("Logging stopped");
 }
 
+bool bp_log_sessions_supported() {
+  return log_sessions_supported;
+}
+
+int bp_log_get_num_sessions() {
+  return num_log_sessions;
+}
+
+const struct bp_log_session *bp_log_get_session(int idx) {
+  if (idx < 0 || idx >= num_log_sessions)
+    return NULL;
+  return &log_sessions[idx];
+}
+
+bool bp_log_delete_session(int idx) {
+  if (idx < 0 || idx >= num_log_sessions)
+    return false;
+  /* the session currently being written cannot be deleted */
+  if (log_status == STATUS_LOG_STARTED && idx == num_log_sessions - 1)
+    return false;
+  at_write(&at_logger_session_delete, (uint8_t) idx, false);
+  schedule_log_sessions_read();
+  DBG("Deleting log session %d", idx + 1);
+  return true;
+}
+
+bool bp_log_download(int session_idx, LogDownloadHandler handler) {
+  if (!handler || log_download.handler || init_state != INITIALIZED)
+    return false;
+  /* the log can only be read while it is not written or erased */
+  if (log_status != STATUS_LOG_DIRTY && log_status != STATUS_LOG_STOPPED &&
+      log_status != STATUS_LOG_FULL)
+    return false;
+  if (session_idx >= num_log_sessions)
+    return false;
+  if (log_sessions_supported) {
+    at_write(&at_logger_session_select,
+             session_idx < 0 ? LOG_DOWNLOAD_ALL_SESSIONS : (uint8_t) session_idx,
+             false);
+  }
+  log_download.handler = handler;
+  log_download.paused = false;
+  log_download.bytes = 0;
+  log_download.retries = 0;
+  log_download.read_duration_ms = 0;
+  /* give the backpack time to process the session selection */
+  log_download_schedule(LOG_SESSIONS_READ_DELAY_MS);
+  DBG("Log download of session %d started", session_idx + 1);
+  return true;
+}
+
+void bp_log_download_cancel() {
+  if (!log_download.handler)
+    return;
+  DBG("Log download cancelled after %u bytes", (unsigned) log_download.bytes);
+  log_download.handler = NULL;
+  log_download.wait_for_poll = false;
+  if (log_download.timer) {
+    sched_cancel(log_download.timer);
+    log_download.timer = SCHED_TIMER_NONE;
+  }
+}
+
+void bp_log_download_pause(bool pause) {
+  if (log_download.paused == pause)
+    return;
+  log_download.paused = pause;
+  if (!pause && log_download.handler)
+    log_download_schedule(0);
+}
+
+bool bp_log_download_active() {
+  return log_download.handler != NULL;
+}
+
+void bp_log_set_download_share(uint8_t percent) {
+  if (percent < 1)
+    percent = 1;
+  else if (percent > 100)
+    percent = 100;
+  log_download.share = percent;
+}
+
+void bp_log_set_wrap_around(bool enable) {
+  if (log_wrap_around == enable)
+    return;
+  log_wrap_around = enable;
+  DBG("Log wrap-around %s", enable ? "enabled" : "disabled");
+  if (log_status == STATUS_LOG_STARTED)
+    send_log_wrap_around();
+}
+
+bool bp_log_get_wrap_around() {
+  return log_wrap_around;
+}
+
 void bp_set_log_interrupt_handler(LogInterruptHandler handler) {
   log_interrupt_handler = handler;
 }
+
+void bp_set_connection_state_observer(ConnectionStateHandler handler) {
+  connection_state_observer = handler;
+}
@@ -46,6 +46,7 @@
 
 #define BACKPACK_TIMEOUT 200
 #define DEFAULT_POLL_INTERVAL_MS 500
+#define DEFAULT_PREFETCH_INTERVAL_MS 5000
 #define DESTROY_RETRY_INTERVAL_MS 10
 
 static const size_t ATTR_EVENT_LEN = sizeof(int32_t);
@@ -127,8 +128,17 @@ static const size_t ATTR_LOGGER_PAUSE_LEN = 1;
 static const SmartstrapAttributeId ATTR_LOGGER_RESUME   = 0x0004;
 static const size_t ATTR_LOGGER_RESUME_LEN = 1;
 static const SmartstrapAttributeId ATTR_LOGGER_ENTRIES  = 0x0005;
+static const size_t ATTR_LOGGER_ENTRIES_MAX_LEN = 128;
 static const SmartstrapAttributeId ATTR_LOGGER_STATE    = 0x0006;
 static const size_t ATTR_LOGGER_STATE_LEN = sizeof(uint8_t);
+static const SmartstrapAttributeId ATTR_LOGGER_WRAP_AROUND = 0x0007;
+static const size_t ATTR_LOGGER_WRAP_AROUND_LEN = sizeof(uint8_t);
+static const SmartstrapAttributeId ATTR_LOGGER_SESSIONS = 0x0008;
+static const SmartstrapAttributeId ATTR_LOGGER_SESSION_NEW = 0x0009;
+static const SmartstrapAttributeId ATTR_LOGGER_SESSION_DELETE = 0x000A;
+static const size_t ATTR_LOGGER_SESSION_DELETE_LEN = sizeof(uint8_t);
+static const SmartstrapAttributeId ATTR_LOGGER_SESSION_SELECT = 0x000B;
+static const size_t ATTR_LOGGER_SESSION_SELECT_LEN = sizeof(uint8_t);
 
 /* System Service Attributes */
 static const SmartstrapAttributeId ATTR_SYSTEM_PLUGGED    = 0x0002;
@@ -151,6 +161,13 @@ typedef struct {
   void (*on_sensor_readings)(int32_t t_c, int32_t rh, int32_t t_skin, int16_t reserved0, int16_t reserved1);
   /** New processed values are available */
   void (*on_processed_values)(float t_skin, float t_fl, float t_apparent, float t_humidex);
+  /**
+   * New processed values are available, in milli-degrees
+   * The values are decoded without floating point math, set this instead of
+   * on_processed_values to keep the screen math in integers.
+   */
+  void (*on_processed_values_milli)(int32_t t_skin, int32_t t_fl,
+                                    int32_t t_apparent, int32_t t_humidex);
   /** An airtouch event is triggered */
   void (*on_airtouch_event)(bool start);
   /** The subscription triggers an initial event to report the state */
@@ -163,13 +180,23 @@ typedef void (*BackpackAttributeHandler)(const uint8_t *data, size_t length,
 typedef void (*TemperatureCompensationModeHandler)(uint8_t currentMode,
                                                    uint8_t numbereOfmodes);
 
+typedef void (*ConnectionStateHandler)(bool is_connected);
+
 /** Opaque struct for subscribed backpack attributes */
 struct BackpackAttribute {
   SmartstrapAttribute *attribute;
   const char *desc;
   BackpackAttributeHandler handler;
   int id;
+  size_t len;
   volatile bool open_read;
+  /** the open read was issued by the prefetching */
+  bool prefetch_read;
+  /** last value read, only kept for prefetched attributes */
+  uint8_t *cache;
+  size_t cache_len;
+  /** time of the cached value, 0 if none */
+  uint64_t cache_time_ms;
 };
 
 /** Initialize backpack module */
@@ -193,8 +220,14 @@ void bp_init_attribute(struct BackpackAttribute *attribute,
                        uint16_t flags, size_t len,
                        const char *desc, BackpackAttributeHandler handler);
 
-/** Start polling a custom attribute */
+/** Poll a custom attribute, see bp_start_polling */
 void bp_subscribe_attribute(struct BackpackAttribute *at);
+/**
+ * Start polling the subscribed attributes, it is called by bp_subscribe.
+ * The polling pauses while the backpack is disconnected and runs until
+ * bp_unsubscribe.
+ */
+void bp_start_polling();
 
 void bp_set_temperature_compensation_mode(uint8_t mode,
                                           TemperatureCompensationModeHandler handler);
@@ -203,6 +236,32 @@ void bp_set_temperature_compensation_mode(uint8_t mode,
 void bp_set_polling_interval(uint32_t interval_ms);
 /** Unsubscribe from all backpack event handlers and reset polling interval */
 void bp_unsubscribe();
+/**
+ * Prefetch the attributes of the given handlers at a low rate, e.g. for the
+ * screens next to the shown one.
+ * The last prefetched value is replayed to the handlers as soon as they
+ * subscribe, such that a screen shows current values right away.
+ * Prefetching is not affected by bp_unsubscribe.
+ */
+void bp_prefetch(BackpackHandlers handlers);
+/**
+ * Age in ms of the value passed to the handler being called
+ * It is 0 for values read just now and nonzero for a replayed prefetched
+ * value, which handlers adding to a time series, e.g. a chart, should skip.
+ */
+uint32_t bp_get_value_age_ms();
+/** Prefetch a custom attribute, see bp_prefetch */
+void bp_prefetch_attribute(struct BackpackAttribute *at);
+/** Stop prefetching, cached values are kept */
+void bp_prefetch_clear();
+/** Set prefetch interval in ms */
+void bp_set_prefetch_interval(uint32_t interval_ms);
+/**
+ * Register a handler for connection state changes which is kept across
+ * bp_unsubscribe, e.g. for UI shared by all screens.
+ * It is called before the subscribed on_connection_state_changed handler.
+ */
+void bp_set_connection_state_observer(ConnectionStateHandler handler);
 /**
  * Try cleanup of backpack attribute.
  * Keep trying each event tick until success: The recommended interval is
@@ -224,45 +283,173 @@ void bp_deinit();
  */
 bool bp_readval(const uint8_t *data, size_t len, int *offset, void *result,
                 size_t type_len, const char *desc);
+/**
+ * Read a float value from buffer at given offset as milli-units
+ * Same as bp_readval but the float is converted without floating point math.
+ */
+bool bp_readval_milli(const uint8_t *data, size_t len, int *offset,
+                      int32_t *result, const char *desc);
 /* Logging functions */
-/** Time in s (with safety margin) to erase the log */
+/**
+ * Time in s (with safety margin) to erase the log.
+ * The erase progress is polled from the backpack while clearing, this time
+ * is only used as an upper bound in case the backpack never reports EMPTY.
+ */
 #define BP_LOG_CLEAR_TIME 70
 
+/* The states are only compared for equality, their order is not significant */
 enum bp_log_status {
-  /*
-   * REORDERING WARNING:
-   * Code makes use of relative comparison operators
-   */
   STATUS_LOG_DIRTY,
   STATUS_LOG_CLEARING,
   STATUS_LOG_CLEARED,
   STATUS_LOG_STARTED,
-  STATUS_LOG_STOPPED
+  STATUS_LOG_STOPPED,
+  /** Log is full and does not record anymore (wrap-around disabled) */
+  STATUS_LOG_FULL
+};
+
+/**
+ * Logger state as reported by the backpack firmware
+ * CAUTION! Keep in sync with backpack firmware!
+ */
+enum bp_logger_state {
+  LOGGER_STATE_EMPTY,
+  LOGGER_STATE_DIRTY,
+  LOGGER_STATE_ERASING,
+  LOGGER_STATE_WRITING,
+  LOGGER_STATE_WRITING_PAUSED,
+  LOGGER_STATE_LOG_FULL,
+  LOGGER_STATE_READING,
+  LOGGER_STATE_READING_FINISHED, // everything read
+  /* Not a firmware state: the state has not been read yet */
+  LOGGER_STATE_UNKNOWN = 0xff
+};
+
+/** Maximal number of sessions in the backpack's log session index */
+#define BP_LOG_MAX_SESSIONS 8
+
+/**
+ * Entry of the log session index
+ * CAUTION! Keep in sync with backpack firmware!
+ */
+struct bp_log_session {
+  /** Session start as unix timestamp in s */
+  uint32_t start_time;
+  /** Index of the first log entry of the session */
+  uint32_t first_entry;
+  /** Number of log entries in the session */
+  uint32_t num_entries;
+  /** Interval between two log entries in ms */
+  uint32_t log_interval_ms;
 };
 
+static const size_t ATTR_LOGGER_SESSIONS_LEN =
+    BP_LOG_MAX_SESSIONS * sizeof(struct bp_log_session);
+
 typedef void (*LogInterruptHandler)();
 
+enum bp_log_download_event {
+  /** A block of log entries was read */
+  LOG_DOWNLOAD_DATA,
+  /** All entries were read, no more data follows */
+  LOG_DOWNLOAD_FINISHED,
+  /** The transfer was aborted, e.g. the backpack was disconnected */
+  LOG_DOWNLOAD_FAILED
+};
+
+/**
+ * Handler for downloaded log entries
+ * data is only valid for LOG_DOWNLOAD_DATA events and during the call.
+ */
+typedef void (*LogDownloadHandler)(enum bp_log_download_event event,
+                                   const uint8_t *data, size_t length);
+
 /** Get the current log status */
 enum bp_log_status bp_log_get_status();
+/** Get the last logger state reported by the backpack */
+enum bp_logger_state bp_log_get_logger_state();
 /**
  * Clear the current log if dirty.
  * This method may be called to get the remaining clear time.
  * Returns the remaining time to clear the log, 0 when cleared.
+ * The log status changes to STATUS_LOG_CLEARED as soon as the backpack reports
+ * the erase to be completed and the log interrupt handler is called.
  */
 time_t bp_log_clear();
 /** Start logging */
 void bp_log_start();
 /** Stop logging */
 void bp_log_stop();
+/**
+ * Start a new log session appended to a dirty or stopped log, such that the
+ * log does not need to be cleared between recordings.
+ * Returns false if the log cannot hold another session or the backpack does
+ * not support sessions.
+ */
+bool bp_log_new_session();
+/** Whether the backpack keeps a log session index */
+bool bp_log_sessions_supported();
+/** Number of sessions in the log (mirrored from the backpack) */
+int bp_log_get_num_sessions();
+/** Get a session from the mirrored log session index, NULL if out of range */
+const struct bp_log_session *bp_log_get_session(int idx);
+/**
+ * Delete a single session from the log without touching the others.
+ * The session being recorded cannot be deleted.
+ */
+bool bp_log_delete_session(int idx);
 /**
  * Returns a bitmask of logged values
  * The lower 16 bit correspond to the sensor readings while
  * the upper 16 bit correspond to the processed values.
  */
 uint32_t bp_get_logged_values_mask();
-/** Get remaining time until log cleared */
+/** Interval between two log entries in ms as requested when logging starts */
+uint32_t bp_log_get_interval_ms();
+/**
+ * Get remaining time until log cleared.
+ * This is an upper bound, 0 is returned as soon as the erase completed.
+ */
 time_t bp_log_remaining();
-/** Register a handler to be called on unwanted logging interruptions */
+/**
+ * Enable or disable wrap-around logging.
+ * When enabled, the backpack drops the oldest log blocks when the log is full
+ * and keeps recording the newest data instead of stopping with a full log.
+ * The setting is sent to the backpack whenever logging is started or resumed.
+ */
+void bp_log_set_wrap_around(bool enable);
+/** Whether wrap-around logging is enabled */
+bool bp_log_get_wrap_around();
+/**
+ * Download the log in the background.
+ * The transfer shares the link with the live polling, which keeps its polling
+ * interval: log entries are only read in between polls.
+ * Only a dirty, stopped or full log can be downloaded.
+ *
+ * @param session_idx   index of the session to download, -1 for the whole log
+ * @param handler       receives the log entries block by block
+ * @return true if the download was started
+ */
+bool bp_log_download(int session_idx, LogDownloadHandler handler);
+/** Abort a running download, the handler is not called anymore */
+void bp_log_download_cancel();
+/**
+ * Pause or resume a running download, e.g. while the receiver of the data is
+ * busy. A read in progress still completes.
+ */
+void bp_log_download_pause(bool pause);
+/** Whether a log download is running */
+bool bp_log_download_active();
+/**
+ * Set the share of the link a download may use in percent (1-100).
+ * At 100% (default) log entries are read back to back in between polls.
+ */
+void bp_log_set_download_share(uint8_t percent);
+/**
+ * Register a handler to be called on unwanted logging interruptions, i.e.
+ * whenever the backpack reports a log state change such as a full log, and
+ * when the log session index has been updated.
+ */
 void bp_set_log_interrupt_handler(LogInterruptHandler handler);
 
 #endif /* BACKPACK_H */
@@ -0,0 +1,382 @@
+/*
+ * Copyright (c) 2016, Sensirion AG
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Sensirion AG nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pebble.h>
+#include "utils.h"
+#include "scheduler.h"
+#include "history.h"
+#include "chart.h"
+
+#define CHART_LEN HISTORY_LEN
+
+/** Baseline offset of the chart in pixels */
+static const int CHART_MARGIN = 1;
+static const int TOAST_TIMEOUT_MS = 2000;
+static const uint32_t TOAST_SLACK_MS = 250;
+/** The auto range shrinks when the data fills less than this share */
+static const int32_t AUTO_RANGE_MIN_FILL_PERCENT = 40;
+
+/** Range index 0 is the auto range, the fixed ranges follow */
+#define RANGE_AUTO 0
+static const char *AUTO_RANGE_DESC = "auto";
+static const char *RANGE_CHANGE_TEXT = "Changing chart scale to\n%s";
+
+enum chart_view {
+  VIEW_RECENT,
+  VIEW_HOUR,
+  VIEW_SESSION,
+  VIEW_NUM_INDICES
+};
+static const char *CHART_VIEW_DESC[] = {
+  "last 80 s",
+  "last hour",
+  "whole session"
+};
+static const char *VIEW_CHANGE_TEXT = "Showing\n%s";
+
+struct Chart {
+  const struct chart_config *config;
+  GRect frame;
+  Layer *axes_layer;
+  Layer *chart_layer;
+  TextLayer *toast_text_layer;
+  SchedTimer toast_show_timer;
+  GPath *path;
+  GPoint path_points[CHART_LEN + 2];
+  char toast_text_layer_buf[60];
+  int size;
+  /** values shown, oldest first */
+  int32_t values[CHART_LEN];
+  /** pixels per milli-unit as Q16 fixed point */
+  int32_t y_scale;
+  /** range shown */
+  int32_t view_min;
+  int32_t view_max;
+  int range_idx;
+  enum chart_view view;
+  /** history level of the values shown */
+  int view_level;
+  /** values were added since the last render */
+  bool dirty;
+  /** extremes of the values shown for the auto range */
+  struct history_window extremes;
+  struct history history;
+};
+
+static int16_t scale_idx_value(Chart *chart, int idx) {
+  return (idx * chart->frame.size.w) / CHART_LEN;
+}
+
+static int16_t scale_value(Chart *chart, int32_t v) {
+  if (v < chart->view_min)
+    v = chart->view_min;
+  else if (v > chart->view_max)
+    v = chart->view_max;
+  return chart->frame.size.h - CHART_MARGIN -
+         (((v - chart->view_min) * chart->y_scale) >> 16);
+}
+
+/*
+ * Update the range shown, returns true if it changed. The auto range only
+ * changes when the data leaves the view or fills too little of it.
+ */
+static bool update_view_range(Chart *chart) {
+  const struct chart_config *config = chart->config;
+  int32_t lo;
+  int32_t hi;
+  if (chart->range_idx != RANGE_AUTO) {
+    lo = config->ranges[chart->range_idx - 1].min;
+    hi = config->ranges[chart->range_idx - 1].max;
+  } else if (history_window_empty(&chart->extremes)) {
+    lo = config->default_min;
+    hi = config->default_max;
+  } else {
+    int32_t min = history_window_min(&chart->extremes);
+    int32_t max = history_window_max(&chart->extremes);
+    int32_t span = chart->view_max - chart->view_min;
+    if (span > 0 && min >= chart->view_min && max <= chart->view_max &&
+        (max - min + 2 * config->auto_margin) * 100 >=
+        span * AUTO_RANGE_MIN_FILL_PERCENT)
+      return false;
+
+    int32_t margin = (max - min) / 10;
+    if (margin < config->auto_margin)
+      margin = config->auto_margin;
+    if (margin < 1)
+      margin = 1;
+    lo = min - margin;
+    if (lo < 0 && !config->allow_negative)
+      lo = 0;
+    hi = max + margin;
+    /* values all below the clamped minimum still need a non-empty range */
+    if (hi < lo + margin)
+      hi = lo + margin;
+  }
+  if (lo == chart->view_min && hi == chart->view_max)
+    return false;
+  chart->view_min = lo;
+  chart->view_max = hi;
+  /* the Q16 product stays below 2^31 for values within the range */
+  chart->y_scale = ((chart->frame.size.h - CHART_MARGIN) << 16) / (hi - lo);
+  return true;
+}
+
+/* Close the path below the newest value */
+static void close_path(Chart *chart) {
+  int len = chart->size;
+  if (len == 0) {
+    chart->path->num_points = 0;
+    return;
+  }
+  chart->path_points[len + 1] = (GPoint) {
+    .x = scale_idx_value(chart, len - 1),
+    .y = chart->frame.size.h
+  };
+  chart->path->num_points = len + 2;
+}
+
+/* Recompute all points, only needed when the range changes */
+static void rescale(Chart *chart) {
+  int i;
+  for (i = 0; i < chart->size; ++i)
+    chart->path_points[i + 1].y = scale_value(chart, chart->values[i]);
+}
+
+static void append_value(Chart *chart, int32_t v) {
+  if (chart->size == CHART_LEN) {
+    /* shift the history left, the x coordinates stay in place */
+    memmove(chart->values, chart->values + 1,
+            (CHART_LEN - 1) * sizeof(chart->values[0]));
+    int i;
+    for (i = 1; i < CHART_LEN; ++i)
+      chart->path_points[i].y = chart->path_points[i + 1].y;
+  } else {
+    chart->size += 1;
+  }
+  int len = chart->size;
+  chart->values[len - 1] = v;
+  history_window_push(&chart->extremes, v, v);
+  bool rescale_needed = update_view_range(chart);
+  if (!chart->path)
+    return;
+  if (rescale_needed)
+    rescale(chart);
+  chart->path_points[len] = (GPoint) {
+    .x = scale_idx_value(chart, len - 1),
+    .y = scale_value(chart, v)
+  };
+  close_path(chart);
+}
+
+static int get_view_level(Chart *chart) {
+  switch (chart->view) {
+  case VIEW_HOUR:
+    return HISTORY_LEVEL_HOUR;
+  case VIEW_SESSION:
+    return history_level_for(chart->history.num_samples);
+  case VIEW_RECENT:
+  default:
+    return HISTORY_LEVEL_RAW;
+  }
+}
+
+/* Load the newest buckets of the selected view, at most CHART_LEN */
+static void load_view(Chart *chart) {
+  int level = get_view_level(chart);
+  int len = history_len(&chart->history, level);
+  int start = len > CHART_LEN ? len - CHART_LEN : 0;
+  struct history_bucket bucket;
+  int i;
+  chart->view_level = level;
+  chart->size = len - start;
+  history_window_init(&chart->extremes, CHART_LEN);
+  for (i = 0; i < chart->size; ++i) {
+    history_get(&chart->history, level, start + i, &bucket);
+    chart->values[i] = bucket.mean;
+    history_window_push(&chart->extremes, bucket.min, bucket.max);
+  }
+  update_view_range(chart);
+  if (!chart->path)
+    return;
+  rescale(chart);
+  close_path(chart);
+}
+
+static void on_axes_update_proc(Layer *layer, GContext *ctx) {
+  GRect rect = layer_get_bounds(layer);
+  graphics_context_set_stroke_color(ctx, GColorWhite);
+  graphics_draw_rect(ctx, rect);
+}
+
+static void on_chart_update_proc(Layer *layer, GContext *ctx) {
+  Chart *chart = *(Chart **) layer_get_data(layer);
+  if (chart->size == 0)
+    return;
+  graphics_context_set_fill_color(ctx, chart->config->color);
+  gpath_draw_filled(ctx, chart->path);
+}
+
+static void hide_toast(void *data) {
+  Chart *chart = data;
+  chart->toast_show_timer = SCHED_TIMER_NONE;
+  layer_set_hidden(text_layer_get_layer(chart->toast_text_layer), true);
+}
+
+static void show_toast(Chart *chart) {
+  if (!chart->toast_text_layer)
+    return;
+  text_layer_set_text(chart->toast_text_layer, chart->toast_text_layer_buf);
+  layer_set_hidden(text_layer_get_layer(chart->toast_text_layer), false);
+
+  if (!chart->toast_show_timer ||
+      !sched_reschedule(chart->toast_show_timer, TOAST_TIMEOUT_MS)) {
+    chart->toast_show_timer = sched_register(TOAST_TIMEOUT_MS, TOAST_SLACK_MS,
+                                             hide_toast, chart);
+  }
+}
+
+Chart *chart_create(const struct chart_config *config, GRect frame) {
+  Chart *chart = malloc(sizeof(Chart));
+  if (!chart) {
+    ERR("Out of memory for chart");
+    return NULL;
+  }
+  memset(chart, 0, sizeof(Chart));
+  chart->config = config;
+  chart->frame = frame;
+  history_init(&chart->history);
+  load_view(chart);
+  return chart;
+}
+
+void chart_destroy(Chart *chart) {
+  free(chart);
+}
+
+void chart_attach(Chart *chart, Layer *parent) {
+  GRect bounds = GRect(0, 0, chart->frame.size.w, chart->frame.size.h);
+  chart->axes_layer = layer_create(chart->frame);
+  chart->chart_layer = layer_create_with_data(bounds, sizeof(Chart *));
+  *(Chart **) layer_get_data(chart->chart_layer) = chart;
+  layer_set_update_proc(chart->axes_layer, on_axes_update_proc);
+  layer_set_update_proc(chart->chart_layer, on_chart_update_proc);
+  layer_add_child(chart->axes_layer, chart->chart_layer);
+  layer_add_child(parent, chart->axes_layer);
+
+  chart->path_points[0] = (GPoint) { .x = 0, .y = chart->frame.size.h };
+  int i;
+  for (i = 0; i < CHART_LEN; ++i)
+    chart->path_points[i + 1].x = scale_idx_value(chart, i);
+  GPathInfo path_info = { .num_points = 0, .points = chart->path_points };
+  chart->path = gpath_create(&path_info);
+  update_view_range(chart);
+  rescale(chart);
+  close_path(chart);
+
+  chart->toast_text_layer = text_layer_create(GRect(14, 52, 117, 48));
+  text_layer_set_font(chart->toast_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_14));
+  text_layer_set_text_alignment(chart->toast_text_layer, GTextAlignmentCenter);
+  layer_add_child(parent, text_layer_get_layer(chart->toast_text_layer));
+  layer_set_hidden(text_layer_get_layer(chart->toast_text_layer), true);
+}
+
+void chart_detach(Chart *chart) {
+  if (chart->toast_show_timer) {
+    sched_cancel(chart->toast_show_timer);
+    chart->toast_show_timer = SCHED_TIMER_NONE;
+  }
+  text_layer_destroy(chart->toast_text_layer);
+  chart->toast_text_layer = NULL;
+  gpath_destroy(chart->path);
+  chart->path = NULL;
+  layer_destroy(chart->chart_layer);
+  layer_destroy(chart->axes_layer);
+  chart->chart_layer = NULL;
+  chart->axes_layer = NULL;
+}
+
+void chart_add_value(Chart *chart, int32_t value) {
+  history_add(&chart->history, value);
+  if (chart->view == VIEW_RECENT) {
+    append_value(chart, value);
+    chart->dirty = true;
+    return;
+  }
+  /*
+   * The aggregated views are only reloaded when a bucket closes or the
+   * session view moves to a coarser level, the newest bucket shown when
+   * switching the view is completed then.
+   */
+  if (get_view_level(chart) != chart->view_level ||
+      chart->history.num_samples % history_period(chart->view_level) == 0) {
+    load_view(chart);
+    chart->dirty = true;
+  }
+}
+
+void chart_render(Chart *chart) {
+  if (chart->dirty && chart->chart_layer)
+    layer_mark_dirty(chart->chart_layer);
+  chart->dirty = false;
+}
+
+void chart_reset(Chart *chart) {
+  DBG("Resetting chart");
+  history_init(&chart->history);
+  load_view(chart);
+  if (chart->chart_layer)
+    layer_mark_dirty(chart->chart_layer);
+}
+
+void chart_next_range(Chart *chart) {
+  chart->range_idx = (chart->range_idx + 1) % (chart->config->num_ranges + 1);
+  update_view_range(chart);
+  if (chart->path)
+    rescale(chart);
+  if (chart->chart_layer)
+    layer_mark_dirty(chart->chart_layer);
+
+  snprintf(chart->toast_text_layer_buf, sizeof(chart->toast_text_layer_buf),
+           RANGE_CHANGE_TEXT, chart->range_idx == RANGE_AUTO ? AUTO_RANGE_DESC :
+           chart->config->ranges[chart->range_idx - 1].desc);
+  show_toast(chart);
+}
+
+void chart_next_view(Chart *chart) {
+  chart->view = (chart->view + 1) % VIEW_NUM_INDICES;
+  load_view(chart);
+  if (chart->chart_layer)
+    layer_mark_dirty(chart->chart_layer);
+
+  snprintf(chart->toast_text_layer_buf, sizeof(chart->toast_text_layer_buf),
+           VIEW_CHANGE_TEXT, CHART_VIEW_DESC[chart->view]);
+  show_toast(chart);
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2016, Sensirion AG
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Sensirion AG nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CHART_H
+#define CHART_H
+
+#include <pebble.h>
+
+/**
+ * Chart widget for a single channel
+ *
+ * The chart keeps a multi-resolution history of the values added (see
+ * history.h) and shows the last 80 s, the last hour or the whole session.
+ * The path points are kept pre-scaled, a new value only shifts and appends
+ * a point and all points are only rescaled when the range changes.
+ *
+ * The chart and its history are allocated once with chart_create, usually
+ * from the SensiSmartApp load callback. The layers only exist between
+ * chart_attach and chart_detach, i.e. while the window is loaded.
+ *
+ * All values are fixed point milli-units.
+ */
+
+/** Fixed chart range */
+struct chart_range {
+  const char *desc;
+  int32_t min;
+  int32_t max;
+};
+
+struct chart_config {
+  /** Fixed ranges selectable in addition to the auto range */
+  const struct chart_range *ranges;
+  int num_ranges;
+  /** Range shown in auto range before any values are added */
+  int32_t default_min;
+  int32_t default_max;
+  /** Margin added above and below the values in auto range */
+  int32_t auto_margin;
+  /** Whether the auto range may extend below zero */
+  bool allow_negative;
+  GColor color;
+};
+
+typedef struct Chart Chart;
+
+/**
+ * Allocate a chart
+ *
+ * @param config  chart configuration, must stay valid while the chart exists
+ * @param frame   frame of the chart layer
+ * @return NULL when out of memory
+ */
+Chart *chart_create(const struct chart_config *config, GRect frame);
+
+/** Free a chart, it must not be attached */
+void chart_destroy(Chart *chart);
+
+/** Create the chart layers and add them to the parent layer */
+void chart_attach(Chart *chart, Layer *parent);
+
+/** Destroy the chart layers, the history is kept */
+void chart_detach(Chart *chart);
+
+/**
+ * Add a value to the chart, it is drawn with the next chart_render
+ * The hour and session views only change when one of their buckets closes.
+ */
+void chart_add_value(Chart *chart, int32_t value);
+
+/** Mark the chart dirty if values were added since the last call */
+void chart_render(Chart *chart);
+
+/** Clear the chart history */
+void chart_reset(Chart *chart);
+
+/** Switch to the next range and show a notice */
+void chart_next_range(Chart *chart);
+
+/**
+ * Switch to the next view (80 s, hour, session) and show a notice
+ * The chart screens switch on a long up press.
+ */
+void chart_next_view(Chart *chart);
+
+#endif /* CHART_H */
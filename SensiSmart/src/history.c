@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2016, Sensirion AG
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Sensirion AG nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pebble.h>
+#include "history.h"
+
+/** Buckets of the level below per bucket, level 0 aggregates raw samples */
+static const uint16_t LEVEL_RATIO[HISTORY_LEVELS] = {1, 45, 10, 4};
+
+void history_init(struct history *h) {
+  memset(h, 0, sizeof(*h));
+}
+
+static void push_bucket(struct history_level *l,
+                        const struct history_bucket *bucket) {
+  if (l->size < HISTORY_LEN) {
+    l->buckets[(l->head + l->size) % HISTORY_LEN] = *bucket;
+    l->size += 1;
+  } else {
+    l->buckets[l->head] = *bucket;
+    l->head = (l->head + 1) % HISTORY_LEN;
+  }
+}
+
+void history_add(struct history *h, int32_t value) {
+  struct history_bucket bucket = { .min = value, .max = value, .mean = value };
+  int level;
+  h->num_samples += 1;
+  for (level = 0; level < HISTORY_LEVELS; ++level) {
+    struct history_level *l = &h->levels[level];
+    if (l->pending_count == 0) {
+      l->pending_min = bucket.min;
+      l->pending_max = bucket.max;
+      l->pending_sum = 0;
+    } else {
+      if (bucket.min < l->pending_min)
+        l->pending_min = bucket.min;
+      if (bucket.max > l->pending_max)
+        l->pending_max = bucket.max;
+    }
+    /* all buckets of the level below hold the same number of samples */
+    l->pending_sum += bucket.mean;
+    l->pending_count += 1;
+    if (l->pending_count < LEVEL_RATIO[level])
+      return;
+
+    bucket = (struct history_bucket) {
+      .min = l->pending_min,
+      .max = l->pending_max,
+      .mean = l->pending_sum / l->pending_count
+    };
+    l->pending_count = 0;
+    push_bucket(l, &bucket);
+  }
+}
+
+uint32_t history_period(int level) {
+  uint32_t period = 1;
+  int i;
+  for (i = 0; i <= level && i < HISTORY_LEVELS; ++i)
+    period *= LEVEL_RATIO[i];
+  return period;
+}
+
+int history_level_for(uint32_t num_samples) {
+  int level;
+  for (level = 0; level < HISTORY_LEVELS - 1; ++level) {
+    if (num_samples <= history_period(level) * HISTORY_LEN)
+      break;
+  }
+  return level;
+}
+
+int history_len(const struct history *h, int level) {
+  const struct history_level *l = &h->levels[level];
+  return l->size + (l->pending_count ? 1 : 0);
+}
+
+bool history_get(const struct history *h, int level, int idx,
+                 struct history_bucket *bucket) {
+  const struct history_level *l = &h->levels[level];
+  if (idx < 0 || idx >= history_len(h, level))
+    return false;
+  if (idx < l->size) {
+    *bucket = l->buckets[(l->head + idx) % HISTORY_LEN];
+  } else {
+    *bucket = (struct history_bucket) {
+      .min = l->pending_min,
+      .max = l->pending_max,
+      .mean = l->pending_sum / l->pending_count
+    };
+  }
+  return true;
+}
+
+void history_window_init(struct history_window *w, uint16_t len) {
+  memset(w, 0, sizeof(*w));
+  w->len = len < HISTORY_WINDOW_MAX_LEN ? len : HISTORY_WINDOW_MAX_LEN;
+}
+
+static struct history_window_entry *queue_at(struct history_window_queue *q,
+                                             int idx) {
+  return &q->entries[(q->head + idx) % HISTORY_WINDOW_MAX_LEN];
+}
+
+/*
+ * Drop entries which left the window from the front and entries which can
+ * never become the extreme from the back, then append the new value.
+ * is_min selects whether the queue tracks the minimum or the maximum.
+ */
+static void queue_push(struct history_window_queue *q, int32_t value,
+                       uint32_t seq, uint16_t len, bool is_min) {
+  while (q->size && queue_at(q, 0)->seq + len <= seq) {
+    q->head = (q->head + 1) % HISTORY_WINDOW_MAX_LEN;
+    q->size -= 1;
+  }
+  while (q->size) {
+    int32_t back = queue_at(q, q->size - 1)->value;
+    if (is_min ? back < value : back > value)
+      break;
+    q->size -= 1;
+  }
+  *queue_at(q, q->size) = (struct history_window_entry) {
+    .value = value,
+    .seq = seq
+  };
+  q->size += 1;
+}
+
+void history_window_push(struct history_window *w, int32_t min, int32_t max) {
+  queue_push(&w->min, min, w->seq, w->len, true);
+  queue_push(&w->max, max, w->seq, w->len, false);
+  w->seq += 1;
+}
+
+bool history_window_empty(const struct history_window *w) {
+  return w->min.size == 0;
+}
+
+int32_t history_window_min(const struct history_window *w) {
+  return w->min.entries[w->min.head].value;
+}
+
+int32_t history_window_max(const struct history_window *w) {
+  return w->max.entries[w->max.head].value;
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2016, Sensirion AG
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Sensirion AG nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <pebble.h>
+
+/**
+ * Multi-resolution sample history
+ *
+ * Every level is a ring of HISTORY_LEN buckets holding the min, max and mean
+ * of a fixed number of samples. A completed bucket is folded into the
+ * pending bucket of the next level, so adding a sample costs O(levels) and
+ * any level can be read without rescanning raw samples.
+ *
+ * At the 2 s polling interval, the levels cover 80 s, 1 h, 10 h and 40 h.
+ */
+
+#define HISTORY_LEVELS 4
+#define HISTORY_LEN 40
+
+enum history_level_id {
+  /** one bucket per sample */
+  HISTORY_LEVEL_RAW,
+  /** 45 samples per bucket */
+  HISTORY_LEVEL_HOUR,
+  /** 450 samples per bucket */
+  HISTORY_LEVEL_10_HOURS,
+  /** 1800 samples per bucket */
+  HISTORY_LEVEL_40_HOURS
+};
+
+struct history_bucket {
+  int32_t min;
+  int32_t max;
+  int32_t mean;
+};
+
+struct history_level {
+  struct history_bucket buckets[HISTORY_LEN];
+  /** index of the oldest bucket */
+  uint8_t head;
+  uint8_t size;
+  /** aggregate of the buckets of the level below, not yet complete */
+  int32_t pending_min;
+  int32_t pending_max;
+  int32_t pending_sum;
+  uint16_t pending_count;
+};
+
+struct history {
+  struct history_level levels[HISTORY_LEVELS];
+  uint32_t num_samples;
+};
+
+/** Clear the history */
+void history_init(struct history *h);
+
+/** Add a sample to all levels */
+void history_add(struct history *h, int32_t value);
+
+/** Number of samples aggregated into a bucket of the given level */
+uint32_t history_period(int level);
+
+/**
+ * Finest level which covers the given number of most recent samples,
+ * or the coarsest level if none does
+ */
+int history_level_for(uint32_t num_samples);
+
+/**
+ * Number of buckets of a level, including the pending bucket if it holds any
+ * samples
+ */
+int history_len(const struct history *h, int level);
+
+/**
+ * Read a bucket of a level
+ *
+ * @param idx     0 for the oldest bucket up to history_len() - 1 for the
+ *                newest, which may be the pending bucket
+ * @param bucket  bucket to fill
+ * @return false if idx is out of range
+ */
+bool history_get(const struct history *h, int level, int idx,
+                 struct history_bucket *bucket);
+
+/**
+ * Minimum and maximum over the last len pushed values
+ *
+ * Both are tracked in monotonic queues, so a push costs amortized O(1) and
+ * reading the extremes costs O(1).
+ */
+#define HISTORY_WINDOW_MAX_LEN (HISTORY_LEN + 1)
+
+struct history_window_entry {
+  int32_t value;
+  uint32_t seq;
+};
+
+struct history_window_queue {
+  struct history_window_entry entries[HISTORY_WINDOW_MAX_LEN];
+  uint8_t head;
+  uint8_t size;
+};
+
+struct history_window {
+  /** increasing values, the front is the minimum */
+  struct history_window_queue min;
+  /** decreasing values, the front is the maximum */
+  struct history_window_queue max;
+  uint32_t seq;
+  uint16_t len;
+};
+
+/** Clear the window and set its length, at most HISTORY_WINDOW_MAX_LEN */
+void history_window_init(struct history_window *w, uint16_t len);
+
+/**
+ * Push the extremes of the next value, e.g. the min and max of a bucket.
+ * The oldest value leaves the window once it holds len values.
+ */
+void history_window_push(struct history_window *w, int32_t min, int32_t max);
+
+/** Whether no values were pushed */
+bool history_window_empty(const struct history_window *w);
+
+/** Minimum in the window, only valid if it is not empty */
+int32_t history_window_min(const struct history_window *w);
+
+/** Maximum in the window, only valid if it is not empty */
+int32_t history_window_max(const struct history_window *w);
+
+#endif /* HISTORY_H */
@@ -0,0 +1,206 @@
+/*
+ * Receives the log data exported by the watch app and reassembles it into
+ * CSV lines, one line per log entry. Provides the screen configuration page.
+ */
+
+/*
+ * Column names by bit of the logged values mask: the sensor reading flags
+ * in the low and the processed value flags in the high 16 bits, see
+ * backpack.h.
+ */
+var CHANNEL_NAMES = [
+  'T', 'RH', 'Skin T', 'Skin RH', 'r4', 'r5', 'r6', 'r7',
+  'Accel X', 'Accel Y', 'Accel Z', 'Gyro X', 'Gyro Y', 'Gyro Z', 'MPU T',
+  'r15',
+  'Skin T (pv)', 'Apparent T', 'Feels-like T', 'Humidex', 'Compensation mode',
+  'Transpiration', 'Onbody', 'r23', 'r24', 'r25', 'r26', 'r27',
+  'r28', 'r29', 'r30', 'r31'
+];
+
+/*
+ * Screen ids in the order they are shown on the watch, see screens.json. The
+ * list is entered on the configuration page and kept in localStorage under
+ * this key, it is applied on the next start of the watch app. Without a
+ * stored list the watch keeps its configuration.
+ */
+var SCREENS_KEY = 'screens';
+
+var exp = null;
+
+function channelsOf(mask) {
+  var channels = [];
+  for (var bit = 0; bit < 32; ++bit) {
+    if (mask & (1 << bit))
+      channels.push(bit);
+  }
+  return channels;
+}
+
+function beginExport(dict) {
+  var channels = channelsOf(dict.EXPORT_BEGIN >>> 0);
+  exp = {
+    channels: channels,
+    session: 0,
+    startTime: 0,
+    interval: 0,
+    /* entries received of the current session */
+    sessionEntries: 0,
+    key: null,
+    seq: 0,
+    samples: [],
+    bytes: 0,
+    started: Date.now()
+  };
+  var header = ['session', 'time'];
+  for (var i = 0; i < channels.length; ++i)
+    header.push(CHANNEL_NAMES[channels[i]]);
+  exp.lines = [header.join(',')];
+}
+
+/*
+ * The first message of each session carries its number (0 if unknown),
+ * start time and log interval. The entries of a session are timed from its
+ * start, a start time of 0 gives the time since the session started.
+ */
+function beginSession(dict) {
+  exp.session = dict.EXPORT_SESSION;
+  exp.startTime = dict.EXPORT_START_TIME || 0;
+  exp.interval = dict.EXPORT_INTERVAL || 0;
+  exp.sessionEntries = 0;
+  if (exp.key === null)
+    exp.key = exp.startTime || exp.started;
+}
+
+/* samples are little endian int32 in milli-units */
+function appendData(data) {
+  for (var i = 0; i + 3 < data.length; i += 4) {
+    var v = (data[i] | (data[i + 1] << 8) | (data[i + 2] << 16) |
+             (data[i + 3] << 24));
+    exp.samples.push(v);
+  }
+  exp.bytes += data.length;
+
+  var n = exp.channels.length;
+  while (exp.samples.length >= n) {
+    var entry = exp.samples.splice(0, n);
+    var line = [exp.session,
+                exp.startTime * 1000 + exp.sessionEntries * exp.interval];
+    exp.sessionEntries += 1;
+    for (var c = 0; c < n; ++c)
+      line.push((entry[c] / 1000).toFixed(3));
+    exp.lines.push(line.join(','));
+  }
+}
+
+function finishExport(total) {
+  var received = (exp.lines.length - 1) * exp.channels.length;
+  var ms = Date.now() - exp.started;
+  console.log('Export: ' + received + '/' + total + ' samples, ' + exp.bytes +
+              ' B in ' + ms + ' ms (' +
+              Math.round(ms ? exp.bytes * 1000 / ms : 0) + ' B/s)');
+  localStorage.setItem('export-' + (exp.key || exp.started),
+                       exp.lines.join('\n'));
+  exp = null;
+}
+
+function loadScreens() {
+  try {
+    return JSON.parse(localStorage.getItem(SCREENS_KEY));
+  } catch (e) {
+    return null;
+  }
+}
+
+/* "4, 1,2" to [4, 1, 2], null unless all ids are valid */
+function parseScreens(text) {
+  var screens = [];
+  var ids = text.split(',');
+  for (var i = 0; i < ids.length; ++i) {
+    var id = ids[i].trim();
+    if (!/^[0-9]+$/.test(id) || Number(id) < 1 || Number(id) > 255)
+      return null;
+    screens.push(Number(id));
+  }
+  return screens;
+}
+
+function sendScreens(screens) {
+  Pebble.sendAppMessage({ SCREEN_CONFIG: screens }, function() {
+    console.log('Screen configuration sent: ' + screens.join(','));
+  }, function() {
+    console.log('Sending the screen configuration failed');
+  });
+}
+
+function configurationPage(screens) {
+  var value = screens ? screens.join(', ') : '';
+  return 'data:text/html,' + encodeURIComponent(
+    '<!DOCTYPE html><html><head><meta name="viewport" ' +
+    'content="width=device-width"><title>SensiSmart</title></head><body>' +
+    '<h3>Screens</h3><p>Screen ids in the order they are shown, see ' +
+    'screens.json. Leave empty to stop sending a configuration.</p>' +
+    '<input id="screens" value="' + value + '"> ' +
+    '<button onclick="location.href=\'pebblejs://close#\' + ' +
+    'encodeURIComponent(document.getElementById(\'screens\').value)">' +
+    'Save</button></body></html>');
+}
+
+Pebble.addEventListener('ready', function() {
+  console.log('SensiSmart export receiver ready');
+  var screens = loadScreens();
+  if (screens)
+    sendScreens(screens);
+});
+
+Pebble.addEventListener('showConfiguration', function() {
+  Pebble.openURL(configurationPage(loadScreens()));
+});
+
+Pebble.addEventListener('webviewclosed', function(e) {
+  /* the page was cancelled */
+  if (e.response === undefined || e.response === 'CANCELLED')
+    return;
+  var text = decodeURIComponent(e.response).trim();
+  if (!text) {
+    localStorage.removeItem(SCREENS_KEY);
+    console.log('Screen configuration cleared');
+    return;
+  }
+  var screens = parseScreens(text);
+  if (!screens) {
+    console.log('Invalid screen configuration: ' + text);
+    return;
+  }
+  localStorage.setItem(SCREENS_KEY, JSON.stringify(screens));
+  sendScreens(screens);
+});
+
+Pebble.addEventListener('appmessage', function(e) {
+  var dict = e.payload;
+  if (dict.EXPORT_SEQ === undefined)
+    return;
+
+  if (dict.EXPORT_BEGIN !== undefined)
+    beginExport(dict);
+  if (!exp)
+    return;
+
+  if (dict.EXPORT_SEQ < exp.seq) {
+    /* the ack of a previous message got lost, the watch resent it */
+    return;
+  }
+  if (dict.EXPORT_SEQ !== exp.seq) {
+    console.log('Export: expected message ' + exp.seq + ', got ' +
+                dict.EXPORT_SEQ + ', aborting');
+    exp = null;
+    return;
+  }
+  exp.seq += 1;
+
+  if (dict.EXPORT_SESSION !== undefined)
+    beginSession(dict);
+  if (dict.EXPORT_DATA)
+    appendData(dict.EXPORT_DATA);
+  if (dict.EXPORT_END !== undefined)
+    finishExport(dict.EXPORT_END);
+});
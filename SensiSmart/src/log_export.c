@@ -0,0 +1,379 @@
+/*
+ * Copyright (c) 2016, Sensirion AG
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Sensirion AG nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pebble.h>
+#include "backpack.h"
+#include "scheduler.h"
+#include "utils.h"
+#include "log_export.h"
+
+#define EXPORT_OUTBOX_SIZE 1024
+#define MAX_CHANNELS 32
+/** Upper bound of samples per message, the actual batch is fitted at start */
+#define MAX_BATCH_SAMPLES (EXPORT_OUTBOX_SIZE / sizeof(int32_t))
+/** Samples are collected for up to two batches while one is in flight */
+#define STAGE_SAMPLES (2 * MAX_BATCH_SAMPLES)
+/** Room needed to decode another block of log entries */
+#define BLOCK_SAMPLES (ATTR_LOGGER_ENTRIES_MAX_LEN / sizeof(int32_t) + MAX_CHANNELS)
+
+static const int RESEND_DELAY_MS = 200;
+static const int MAX_RESENDS = 5;
+
+static struct {
+  LogExportHandler handler;
+  struct log_export_stats stats;
+  uint64_t start_ms;
+  uint32_t channels_mask;
+  uint16_t num_channels;
+  /** all sessions are exported, one after the other */
+  bool all_sessions;
+  /** session being sent, -1 if the log has no session index */
+  int session_idx;
+  uint32_t log_interval_ms;
+  uint32_t start_time;
+  /** samples of the session not yet sent */
+  uint32_t session_samples_left;
+  /** the next message starts the session and carries its header */
+  bool session_header;
+  uint16_t entry_len;
+  uint16_t batch_samples;
+  uint32_t seq;
+  /** partially received log entry */
+  uint8_t entry[MAX_CHANNELS * sizeof(int32_t)];
+  uint16_t entry_fill;
+  /** decoded samples waiting to be sent */
+  int32_t stage[STAGE_SAMPLES];
+  uint16_t num_staged;
+  /** samples of the message waiting for its acknowledgement */
+  int32_t inflight[MAX_BATCH_SAMPLES];
+  uint16_t num_inflight;
+  bool inflight_has_header;
+  bool inflight_is_last;
+  bool in_flight;
+  bool download_done;
+  uint8_t resends;
+  SchedTimer resend_timer;
+} export;
+
+static bool app_message_registered = false;
+
+static void transmit(void *context);
+
+static void finish(enum log_export_event event) {
+  LogExportHandler handler = export.handler;
+  if (!handler)
+    return;
+  export.handler = NULL;
+  bp_log_download_cancel();
+  if (export.resend_timer) {
+    sched_cancel(export.resend_timer);
+    export.resend_timer = SCHED_TIMER_NONE;
+  }
+  export.stats.duration_ms = time_now_ms() - export.start_ms;
+  if (event == LOG_EXPORT_FINISHED) {
+    INFO("Exported %u samples (%u B) in %u ms: %u B/s",
+         (unsigned) export.stats.samples, (unsigned) export.stats.bytes,
+         (unsigned) export.stats.duration_ms,
+         (unsigned) (export.stats.duration_ms ?
+                     (uint64_t) export.stats.bytes * 1000 /
+                     export.stats.duration_ms : 0));
+  } else {
+    ERR("Export failed after %u samples", (unsigned) export.stats.samples);
+  }
+  handler(event);
+}
+
+static void schedule_resend() {
+  if (++export.resends > MAX_RESENDS) {
+    finish(LOG_EXPORT_FAILED);
+    return;
+  }
+  export.resend_timer = sched_register(RESEND_DELAY_MS, 0, transmit, NULL);
+}
+
+static void transmit(void *context) {
+  DictionaryIterator *iter;
+  export.resend_timer = SCHED_TIMER_NONE;
+  if (app_message_outbox_begin(&iter) != APP_MSG_OK) {
+    schedule_resend();
+    return;
+  }
+  dict_write_uint32(iter, MESSAGE_KEY_EXPORT_SEQ, export.seq);
+  if (export.seq == 0)
+    dict_write_uint32(iter, MESSAGE_KEY_EXPORT_BEGIN, export.channels_mask);
+  if (export.inflight_has_header) {
+    /* sessions are numbered from 1 like on screen, 0 if unknown */
+    dict_write_uint32(iter, MESSAGE_KEY_EXPORT_SESSION, export.session_idx + 1);
+    dict_write_uint32(iter, MESSAGE_KEY_EXPORT_INTERVAL, export.log_interval_ms);
+    dict_write_uint32(iter, MESSAGE_KEY_EXPORT_START_TIME, export.start_time);
+  }
+  if (export.num_inflight) {
+    dict_write_data(iter, MESSAGE_KEY_EXPORT_DATA, (uint8_t *) export.inflight,
+                    export.num_inflight * sizeof(int32_t));
+  }
+  if (export.inflight_is_last) {
+    dict_write_uint32(iter, MESSAGE_KEY_EXPORT_END,
+                      export.stats.samples + export.num_inflight);
+  }
+  if (app_message_outbox_send() != APP_MSG_OK) {
+    schedule_resend();
+    return;
+  }
+}
+
+/* Stop the download while the stage has no room for another block */
+static void update_download_pause() {
+  bp_log_download_pause(export.num_staged + BLOCK_SAMPLES > STAGE_SAMPLES);
+}
+
+/*
+ * Make a session the one being sent, its header goes with its first samples
+ * Without a session index the samples are sent with an unknown start time
+ * and the interval the log was started with.
+ */
+static void begin_session(int idx) {
+  const struct bp_log_session *session = bp_log_get_session(idx);
+  export.session_header = true;
+  if (!session) {
+    export.session_idx = -1;
+    export.start_time = 0;
+    export.log_interval_ms = bp_log_get_interval_ms();
+    export.session_samples_left = UINT32_MAX;
+    return;
+  }
+  export.session_idx = idx;
+  export.start_time = session->start_time;
+  export.log_interval_ms = session->log_interval_ms;
+  export.session_samples_left = session->num_entries * export.num_channels;
+}
+
+/* Move on to the next session of a whole log export once one is sent */
+static void next_session() {
+  while (!export.session_samples_left) {
+    if (export.all_sessions &&
+        export.session_idx + 1 < bp_log_get_num_sessions()) {
+      begin_session(export.session_idx + 1);
+    } else {
+      /* more entries than indexed, keep them with the last session */
+      export.session_samples_left = UINT32_MAX;
+    }
+  }
+}
+
+/* Send the next batch unless a message is waiting for its acknowledgement */
+static void send_next() {
+  if (!export.handler || export.in_flight)
+    return;
+  next_session();
+  /* a message only holds samples of one session */
+  uint16_t n = export.num_staged;
+  if (n > export.batch_samples)
+    n = export.batch_samples;
+  if (n > export.session_samples_left)
+    n = export.session_samples_left;
+  bool last = export.download_done && n == export.num_staged;
+  if (n < export.batch_samples && n < export.session_samples_left && !last)
+    return;
+
+  memcpy(export.inflight, export.stage, n * sizeof(int32_t));
+  export.num_staged -= n;
+  memmove(export.stage, export.stage + n, export.num_staged * sizeof(int32_t));
+  export.num_inflight = n;
+  export.session_samples_left -= n;
+  export.inflight_has_header = export.session_header;
+  export.session_header = false;
+  export.inflight_is_last = last;
+  export.in_flight = true;
+  export.resends = 0;
+  transmit(NULL);
+}
+
+static void decode_entry() {
+  uint32_t mask = export.channels_mask;
+  int offset = 0;
+  int bit;
+  for (bit = 0; mask; ++bit, mask >>= 1) {
+    if (!(mask & 1))
+      continue;
+    int32_t value;
+    if (bit < 16) {
+      /* sensor readings are logged as fixed point milli-units */
+      memcpy(&value, export.entry + offset, sizeof(int32_t));
+    } else {
+      /* processed values are logged as floats, rounded like on screen */
+      uint32_t bits;
+      memcpy(&bits, export.entry + offset, sizeof(bits));
+      value = float_bits_to_milli(bits);
+    }
+    offset += sizeof(int32_t);
+    export.stage[export.num_staged++] = value;
+  }
+}
+
+static void on_download(enum bp_log_download_event event,
+                        const uint8_t *data, size_t length) {
+  switch (event) {
+  case LOG_DOWNLOAD_DATA:
+    while (length) {
+      size_t n = export.entry_len - export.entry_fill;
+      if (n > length)
+        n = length;
+      memcpy(export.entry + export.entry_fill, data, n);
+      export.entry_fill += n;
+      data += n;
+      length -= n;
+      if (export.entry_fill == export.entry_len) {
+        if (export.num_staged + MAX_CHANNELS > STAGE_SAMPLES) {
+          ERR("Export staging buffer overflow");
+          finish(LOG_EXPORT_FAILED);
+          return;
+        }
+        decode_entry();
+        export.entry_fill = 0;
+      }
+    }
+    send_next();
+    /* the stage keeps filling while a message waits for its ack */
+    update_download_pause();
+    break;
+
+  case LOG_DOWNLOAD_FINISHED:
+    if (export.entry_fill)
+      WARN("Dropping incomplete log entry (%d bytes)", export.entry_fill);
+    export.download_done = true;
+    send_next();
+    break;
+
+  case LOG_DOWNLOAD_FAILED:
+    finish(LOG_EXPORT_FAILED);
+    break;
+  }
+}
+
+static void on_outbox_sent(DictionaryIterator *iter, void *context) {
+  if (!export.handler || !export.in_flight)
+    return;
+  export.in_flight = false;
+  export.seq += 1;
+  export.stats.samples += export.num_inflight;
+  export.stats.bytes += export.num_inflight * sizeof(int32_t);
+  export.stats.duration_ms = time_now_ms() - export.start_ms;
+  if (export.inflight_is_last) {
+    finish(LOG_EXPORT_FINISHED);
+    return;
+  }
+  export.handler(LOG_EXPORT_PROGRESS);
+  send_next();
+  update_download_pause();
+}
+
+static void on_outbox_failed(DictionaryIterator *iter, AppMessageResult reason,
+                             void *context) {
+  if (!export.handler || !export.in_flight)
+    return;
+  WARN("Export message %u failed (reason %d)", (unsigned) export.seq, reason);
+  schedule_resend();
+}
+
+uint32_t log_export_outbox_size() {
+  uint32_t outbox_size = app_message_outbox_size_maximum();
+  if (outbox_size > EXPORT_OUTBOX_SIZE)
+    outbox_size = EXPORT_OUTBOX_SIZE;
+  return outbox_size;
+}
+
+static void register_app_message() {
+  if (app_message_registered)
+    return;
+  app_message_register_outbox_sent(on_outbox_sent);
+  app_message_register_outbox_failed(on_outbox_failed);
+  app_message_registered = true;
+}
+
+bool log_export_start(int session_idx, LogExportHandler handler) {
+  if (export.handler || !handler)
+    return false;
+
+  uint32_t mask = bp_get_logged_values_mask();
+  uint16_t num_channels = 0;
+  for (uint32_t m = mask; m; m >>= 1)
+    num_channels += m & 1;
+  if (!num_channels)
+    return false;
+
+  /* fit the batch to the outbox, with room for all other tuples */
+  uint32_t overhead = dict_calc_buffer_size(7, sizeof(uint32_t),
+                                            sizeof(uint32_t), sizeof(uint32_t),
+                                            sizeof(uint32_t), sizeof(uint32_t),
+                                            sizeof(uint32_t), 0);
+  register_app_message();
+  uint32_t batch = (log_export_outbox_size() - overhead) / sizeof(int32_t);
+  if (batch > MAX_BATCH_SAMPLES)
+    batch = MAX_BATCH_SAMPLES;
+
+  memset(&export, 0, sizeof(export));
+  export.handler = handler;
+  export.start_ms = time_now_ms();
+  export.channels_mask = mask;
+  export.num_channels = num_channels;
+  export.entry_len = num_channels * sizeof(int32_t);
+  /* only send complete entries per message */
+  export.batch_samples = batch - batch % num_channels;
+  export.all_sessions = session_idx < 0;
+  begin_session(export.all_sessions ? 0 : session_idx);
+  if (!bp_log_download(session_idx, on_download)) {
+    export.handler = NULL;
+    return false;
+  }
+  DBG("Exporting %d channels in batches of %d samples", num_channels,
+      export.batch_samples);
+  return true;
+}
+
+void log_export_cancel() {
+  if (!export.handler)
+    return;
+  export.handler = NULL;
+  bp_log_download_cancel();
+  if (export.resend_timer) {
+    sched_cancel(export.resend_timer);
+    export.resend_timer = SCHED_TIMER_NONE;
+  }
+  DBG("Export cancelled");
+}
+
+bool log_export_active() {
+  return export.handler != NULL;
+}
+
+const struct log_export_stats *log_export_get_stats() {
+  return &export.stats;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2016, Sensirion AG
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Sensirion AG nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOG_EXPORT_H
+#define LOG_EXPORT_H
+
+#include <pebble.h>
+
+/**
+ * Export of recorded log data to the phone
+ *
+ * The log is downloaded from the backpack, decoded into samples and sent to
+ * the phone in AppMessage batches sized to the outbox. The next batch is
+ * collected while the previous one waits for its acknowledgement. The
+ * PebbleKit JS part (src/js/pebble-js-app.js) reassembles the samples.
+ *
+ * Each sample is sent as int32_t: sensor readings in milli-units as read from
+ * the backpack and processed values scaled by 1000.
+ *
+ * A message only holds samples of one log session. The first message of a
+ * session carries its number, start time and log interval, such that the
+ * phone can time every entry and separate the sessions of a whole log.
+ */
+
+enum log_export_event {
+  /** More samples were sent to the phone */
+  LOG_EXPORT_PROGRESS,
+  /** All samples were acknowledged by the phone */
+  LOG_EXPORT_FINISHED,
+  /** The export was aborted */
+  LOG_EXPORT_FAILED
+};
+
+typedef void (*LogExportHandler)(enum log_export_event event);
+
+struct log_export_stats {
+  /** Number of samples acknowledged by the phone */
+  uint32_t samples;
+  /** Number of payload bytes acknowledged by the phone */
+  uint32_t bytes;
+  /** Time since the export was started in ms */
+  uint32_t duration_ms;
+};
+
+/**
+ * AppMessage outbox size used by the export
+ * AppMessage is opened at startup (SensiSmart.c) with this outbox.
+ */
+uint32_t log_export_outbox_size();
+
+/**
+ * Start exporting the log to the phone
+ *
+ * @param session_idx   index of the log session to export, -1 for all
+ * @param handler       progress handler
+ * @return true if the export was started
+ */
+bool log_export_start(int session_idx, LogExportHandler handler);
+
+/** Abort a running export */
+void log_export_cancel();
+
+/** Whether an export is running */
+bool log_export_active();
+
+/** Statistics of the running or last export */
+const struct log_export_stats *log_export_get_stats();
+
+#endif /* LOG_EXPORT_H */
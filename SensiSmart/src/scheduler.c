@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2016, Sensirion AG
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Sensirion AG nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pebble.h>
+#include "utils.h"
+#include "scheduler.h"
+
+struct sched_task {
+  SchedCallback callback;
+  void *data;
+  uint64_t deadline_ms;
+  uint32_t slack_ms;
+  /** 0 for one-shot tasks */
+  uint32_t period_ms;
+  /** increased whenever the slot is freed, part of the handle */
+  uint16_t generation;
+  bool used;
+  /** the deadline passed when the current wakeup started */
+  bool due;
+};
+
+static struct sched_task tasks[SCHED_MAX_TASKS];
+static AppTimer *timer;
+/** time the timer is armed for */
+static uint64_t timer_ms;
+/** time from timer_ms to the earliest latest start of the tasks */
+static uint32_t timer_slack_ms;
+static bool running;
+static uint32_t num_wakeups;
+static uint32_t num_runs;
+
+static SchedTimer make_handle(int idx) {
+  return ((uint32_t) tasks[idx].generation << 8) | (idx + 1);
+}
+
+static struct sched_task *find_task(SchedTimer handle) {
+  int idx = (int) (handle & 0xff) - 1;
+  if (idx < 0 || idx >= SCHED_MAX_TASKS)
+    return NULL;
+  struct sched_task *task = &tasks[idx];
+  if (!task->used || task->generation != (uint16_t) (handle >> 8))
+    return NULL;
+  return task;
+}
+
+static void free_task(struct sched_task *task) {
+  task->used = false;
+  task->due = false;
+  task->generation += 1;
+}
+
+static void on_timer(void *context);
+
+static void arm() {
+  /* the wakeup re-arms once all due tasks ran */
+  if (running)
+    return;
+
+  uint64_t latest_ms = UINT64_MAX;
+  for (int i = 0; i < SCHED_MAX_TASKS; ++i) {
+    if (tasks[i].used && tasks[i].deadline_ms + tasks[i].slack_ms < latest_ms)
+      latest_ms = tasks[i].deadline_ms + tasks[i].slack_ms;
+  }
+
+  if (latest_ms == UINT64_MAX) {
+    if (timer) {
+      app_timer_cancel(timer);
+      timer = NULL;
+    }
+    return;
+  }
+
+  /*
+   * Wake at the last deadline before the earliest latest start: the tasks due
+   * by then share the wakeup and a task alone runs at its deadline.
+   */
+  uint64_t next_ms = 0;
+  for (int i = 0; i < SCHED_MAX_TASKS; ++i) {
+    if (tasks[i].used && tasks[i].deadline_ms <= latest_ms &&
+        tasks[i].deadline_ms > next_ms)
+      next_ms = tasks[i].deadline_ms;
+  }
+  timer_slack_ms = (uint32_t) (latest_ms - next_ms);
+  if (timer && timer_ms == next_ms)
+    return;
+
+  uint64_t now = time_now_ms();
+  uint32_t delay = next_ms > now ? next_ms - now : 0;
+  if (!timer || !app_timer_reschedule(timer, delay))
+    timer = app_timer_register(delay, on_timer, NULL);
+  timer_ms = next_ms;
+}
+
+static void on_timer(void *context) {
+  timer = NULL;
+  uint64_t now = time_now_ms();
+  /*
+   * The wall clock was set back, keep the relative deadlines. Smaller
+   * differences are within the slack and the tasks wait for the re-arm.
+   */
+  if (now + timer_slack_ms < timer_ms) {
+    uint64_t shift = timer_ms - now;
+    for (int i = 0; i < SCHED_MAX_TASKS; ++i) {
+      if (tasks[i].used)
+        tasks[i].deadline_ms = tasks[i].deadline_ms > shift ?
+                               tasks[i].deadline_ms - shift : 0;
+    }
+  }
+
+  /* tasks registered by the callbacks wait for the next wakeup */
+  for (int i = 0; i < SCHED_MAX_TASKS; ++i)
+    tasks[i].due = tasks[i].used && tasks[i].deadline_ms <= now;
+
+  num_wakeups += 1;
+  running = true;
+  for (int i = 0; i < SCHED_MAX_TASKS; ++i) {
+    struct sched_task *task = &tasks[i];
+    if (!task->due)
+      continue;
+    task->due = false;
+    SchedCallback callback = task->callback;
+    void *data = task->data;
+    if (task->period_ms) {
+      task->deadline_ms += task->period_ms;
+      if (task->deadline_ms <= now)
+        task->deadline_ms = now + task->period_ms;
+    } else {
+      free_task(task);
+    }
+    num_runs += 1;
+    callback(data);
+  }
+  running = false;
+  arm();
+}
+
+static SchedTimer add_task(uint32_t delay_ms, uint32_t slack_ms,
+                           uint32_t period_ms, SchedCallback callback,
+                           void *data) {
+  for (int i = 0; i < SCHED_MAX_TASKS; ++i) {
+    struct sched_task *task = &tasks[i];
+    if (task->used)
+      continue;
+    task->callback = callback;
+    task->data = data;
+    task->deadline_ms = time_now_ms() + delay_ms;
+    task->slack_ms = slack_ms;
+    task->period_ms = period_ms;
+    task->used = true;
+    task->due = false;
+    arm();
+    return make_handle(i);
+  }
+  ERR("No more space for tasks! Increase SCHED_MAX_TASKS");
+  return SCHED_TIMER_NONE;
+}
+
+SchedTimer sched_register(uint32_t delay_ms, uint32_t slack_ms,
+                          SchedCallback callback, void *data) {
+  return add_task(delay_ms, slack_ms, 0, callback, data);
+}
+
+SchedTimer sched_register_periodic(uint32_t period_ms, uint32_t slack_ms,
+                                   SchedCallback callback, void *data) {
+  if (!period_ms)
+    return SCHED_TIMER_NONE;
+  return add_task(period_ms, slack_ms, period_ms, callback, data);
+}
+
+bool sched_reschedule(SchedTimer handle, uint32_t delay_ms) {
+  struct sched_task *task = find_task(handle);
+  if (!task)
+    return false;
+  task->deadline_ms = time_now_ms() + delay_ms;
+  task->due = false;
+  arm();
+  return true;
+}
+
+void sched_cancel(SchedTimer handle) {
+  struct sched_task *task = find_task(handle);
+  if (!task)
+    return;
+  free_task(task);
+  arm();
+}
+
+void sched_log_stats() {
+  INFO("Scheduler: %u wakeups, %u tasks run", (unsigned) num_wakeups,
+       (unsigned) num_runs);
+}
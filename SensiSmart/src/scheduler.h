@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2016, Sensirion AG
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Sensirion AG nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <pebble.h>
+
+/**
+ * Cooperative scheduler running all timed work of the app on one AppTimer
+ *
+ * Every task has a deadline and a slack: it may run up to slack ms late. The
+ * timer is armed for the last deadline before the earliest latest-start of
+ * all tasks and each wakeup runs all tasks whose deadline has passed, such
+ * that tasks with close deadlines share a wakeup while a task alone runs at
+ * its deadline. Use a slack of 0 for latency sensitive work.
+ *
+ * Tasks are kept in a fixed pool, see SCHED_MAX_TASKS. Handles of finished or
+ * cancelled tasks become invalid and are ignored by all functions, so a stale
+ * handle never affects a newer task.
+ */
+
+/** Maximal number of tasks scheduled at the same time */
+#define SCHED_MAX_TASKS 24
+
+/** Handle of a scheduled task */
+typedef uint32_t SchedTimer;
+
+/** Invalid handle, e.g. for tasks that are not scheduled */
+#define SCHED_TIMER_NONE 0
+
+typedef void (*SchedCallback)(void *data);
+
+/**
+ * Run a callback once after delay_ms, at most slack_ms later
+ * @return the task handle, SCHED_TIMER_NONE if the pool is exhausted
+ */
+SchedTimer sched_register(uint32_t delay_ms, uint32_t slack_ms,
+                          SchedCallback callback, void *data);
+
+/**
+ * Run a callback every period_ms until it is cancelled
+ * The period is kept relative to the deadlines, so slack does not add up.
+ * @return the task handle, SCHED_TIMER_NONE if the pool is exhausted
+ */
+SchedTimer sched_register_periodic(uint32_t period_ms, uint32_t slack_ms,
+                                   SchedCallback callback, void *data);
+
+/**
+ * Move the deadline of a task to delay_ms from now
+ * @return false if the task is not scheduled anymore
+ */
+bool sched_reschedule(SchedTimer timer, uint32_t delay_ms);
+
+/** Cancel a task, SCHED_TIMER_NONE and stale handles are ignored */
+void sched_cancel(SchedTimer timer);
+
+/** Log the number of wakeups and the tasks run */
+void sched_log_stats();
+
+#endif /* SCHEDULER_H */
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2016, Sensirion AG
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Sensirion AG nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pebble.h>
+#include "utils.h"
+#include "screen_config.h"
+
+#define SCREEN_CONFIG_PERSIST_KEY 1
+/** Bump when the meaning of the stored ids changes */
+#define SCREEN_CONFIG_VERSION 1
+
+struct screen_config_data {
+  uint8_t version;
+  uint8_t num_ids;
+  uint8_t ids[SCREEN_CONFIG_MAX_SCREENS];
+};
+
+int screen_config_load(uint8_t *ids, int max_ids) {
+  struct screen_config_data data;
+  if (!persist_exists(SCREEN_CONFIG_PERSIST_KEY))
+    return 0;
+
+  int len = persist_read_data(SCREEN_CONFIG_PERSIST_KEY, &data, sizeof(data));
+  if (len < 2 || data.version != SCREEN_CONFIG_VERSION ||
+      data.num_ids > len - 2 || data.num_ids > SCREEN_CONFIG_MAX_SCREENS) {
+    WARN("Ignoring invalid screen configuration");
+    return 0;
+  }
+
+  int n = data.num_ids < max_ids ? data.num_ids : max_ids;
+  memcpy(ids, data.ids, n);
+  return n;
+}
+
+bool screen_config_save(const uint8_t *ids, int num_ids) {
+  struct screen_config_data data;
+  if (num_ids <= 0 || num_ids > SCREEN_CONFIG_MAX_SCREENS)
+    return false;
+
+  data.version = SCREEN_CONFIG_VERSION;
+  data.num_ids = num_ids;
+  memcpy(data.ids, ids, num_ids);
+  return persist_write_data(SCREEN_CONFIG_PERSIST_KEY, &data,
+                            2 + num_ids) == 2 + num_ids;
+}
+
+static void on_inbox_received(DictionaryIterator *iter, void *context) {
+  Tuple *tuple = dict_find(iter, MESSAGE_KEY_SCREEN_CONFIG);
+  if (!tuple)
+    return;
+  if (tuple->type != TUPLE_BYTE_ARRAY) {
+    WARN("Rejected screen configuration of type %d", tuple->type);
+    return;
+  }
+
+  if (screen_config_save(tuple->value->data, tuple->length))
+    INFO("Screen configuration of %d screens stored, applied on next start",
+         tuple->length);
+  else
+    WARN("Rejected screen configuration of %d screens", tuple->length);
+}
+
+void screen_config_listen() {
+  app_message_register_inbox_received(on_inbox_received);
+}
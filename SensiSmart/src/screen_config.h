@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2016, Sensirion AG
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Sensirion AG nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SCREEN_CONFIG_H
+#define SCREEN_CONFIG_H
+
+#include <pebble.h>
+
+/**
+ * Persisted list of the enabled screens
+ *
+ * The screens are identified by the stable ids of the screen catalog in
+ * SensiSmart.c, in the order they are shown. The phone sends a new list as
+ * byte array with the SCREEN_CONFIG message key, it is stored and applied on
+ * the next start of the app.
+ */
+
+/** Maximal number of screens in a configuration */
+#define SCREEN_CONFIG_MAX_SCREENS 32
+
+/** AppMessage inbox needed to receive a configuration */
+#define SCREEN_CONFIG_INBOX_SIZE 64
+
+/**
+ * Read the stored configuration
+ *
+ * @param ids       buffer for the screen ids
+ * @param max_ids   size of the buffer
+ * @return the number of ids read, 0 if no valid configuration is stored
+ */
+int screen_config_load(uint8_t *ids, int max_ids);
+
+/**
+ * Store a configuration, it is applied on the next start
+ *
+ * @return true if the configuration was stored
+ */
+bool screen_config_save(const uint8_t *ids, int num_ids);
+
+/** Handle configurations received from the phone, AppMessage must be open */
+void screen_config_listen();
+
+#endif /* SCREEN_CONFIG_H */
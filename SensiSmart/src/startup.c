@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2016, Sensirion AG
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Sensirion AG nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pebble.h>
+#include "utils.h"
+#include "startup.h"
+
+/**
+ * Phase names and budgets in ms, keep in sync with enum startup_mark
+ * Apps are loaded on their first activation, so app_init only covers the
+ * framework and first_screen includes loading the first app.
+ */
+static const struct {
+  const char *name;
+  uint32_t budget_ms;
+} STARTUP_PHASES[NUM_STARTUP_MARKS] = {
+  [STARTUP_MAIN]         = { "main",         0 },
+  [STARTUP_BP_INIT]      = { "bp_init",      50 },
+  [STARTUP_APP_INIT]     = { "app_init",     50 },
+  [STARTUP_FIRST_SCREEN] = { "first_screen", 150 },
+  [STARTUP_CONNECTED]    = { "connected",    2000 },
+  [STARTUP_FIRST_POLL]   = { "first_poll",   600 },
+  [STARTUP_FIRST_RENDER] = { "first_render", 100 }
+};
+
+static uint64_t mark_ms[NUM_STARTUP_MARKS];
+static int num_marks;
+static bool reported;
+
+void startup_mark(enum startup_mark mark) {
+  /* keep the timeline monotonic */
+  if (mark != num_marks)
+    return;
+  mark_ms[num_marks++] = time_now_ms();
+  if (num_marks == NUM_STARTUP_MARKS)
+    startup_report();
+}
+
+void startup_report() {
+  if (num_marks == 0 || reported)
+    return;
+  reported = true;
+  for (int i = 1; i < num_marks; ++i) {
+    uint32_t duration_ms = mark_ms[i] - mark_ms[i - 1];
+    if (duration_ms > STARTUP_PHASES[i].budget_ms) {
+      WARN("Startup %s: %u ms (budget %u ms)", STARTUP_PHASES[i].name,
+           (unsigned) duration_ms, (unsigned) STARTUP_PHASES[i].budget_ms);
+    } else {
+      INFO("Startup %s: %u ms (budget %u ms)", STARTUP_PHASES[i].name,
+           (unsigned) duration_ms, (unsigned) STARTUP_PHASES[i].budget_ms);
+    }
+  }
+  INFO("Startup total: %u ms until %s",
+       (unsigned) (mark_ms[num_marks - 1] - mark_ms[STARTUP_MAIN]),
+       STARTUP_PHASES[num_marks - 1].name);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2016, Sensirion AG
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Sensirion AG nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <pebble.h>
+
+/**
+ * Startup markers in the order they are reached on a cold start
+ * The phase of a marker is the time since the previous marker.
+ */
+enum startup_mark {
+  STARTUP_MAIN,
+  /** backpack library initialized */
+  STARTUP_BP_INIT,
+  /** framework set up and apps registered, no app is loaded yet */
+  STARTUP_APP_INIT,
+  /** the first screen is loaded and activated */
+  STARTUP_FIRST_SCREEN,
+  /** the backpack handshake completed */
+  STARTUP_CONNECTED,
+  /** the first polled value has been received */
+  STARTUP_FIRST_POLL,
+  /** a screen rendered the first polled values */
+  STARTUP_FIRST_RENDER,
+  NUM_STARTUP_MARKS
+};
+
+/**
+ * Record the time of a startup marker
+ * Only the first occurrence is recorded and only once all earlier markers
+ * are recorded. The startup report is logged with the last marker.
+ */
+void startup_mark(enum startup_mark mark);
+
+/**
+ * Log the duration of each reached startup phase and compare it to its
+ * budget. The report is only logged once.
+ */
+void startup_report();
+
+#endif /* STARTUP_H */
@@ -32,36 +32,100 @@
 
 #include "utils.h"
 
-#define EPS .00001
+int32_t float_bits_to_milli(uint32_t bits) {
+  bool negative = bits >> 31;
+  int exponent = (bits >> 23) & 0xff;
+  uint64_t mantissa = bits & 0x7fffff;
+  uint64_t milli;
 
-int ftoa(char *buf, float val, int precision) {
-  char *start = buf;
-  // start with positive/negative
-  if (val < 0) {
-    *(buf++) = '-';
-    val = -val;
-  }
-  // integer value
-  float round = .5f;
-  for (int i = 0; i < precision; ++i)
-    round *= 0.1;
-  val += round;
-  buf += snprintf(buf, 10, "%d", (int)val);
-  // decimals
-  if (precision > 0) {
-    val -= (int) val;
-    *(buf++) = '.';
-    for (int i = 0; i < precision; ++i) {
-      if (val > EPS) {
-        val *= 10;
-        *(buf++) = '0' + (int) val;
-        val -= (int) val;
-      } else {
-        *(buf++) = '0';
-      }
-    }
+  if (exponent == 0xff && mantissa)
+    return 0;
+  /* zero and denormals (below 1.2e-38) */
+  if (exponent == 0)
+    return 0;
+
+  /* value = 1.mantissa * 2^(exponent - 127), the point is 23 bits left */
+  mantissa = (mantissa | 0x800000) * 1000;
+  int shift = exponent - 127 - 23;
+  if (shift >= 8) {
+    /* beyond the int32_t range, also for infinity */
+    milli = (uint64_t) INT32_MAX + 1;
+  } else if (shift >= 0) {
+    milli = mantissa << shift;
+  } else if (shift > -40) {
+    milli = (mantissa + ((uint64_t) 1 << (-shift - 1))) >> -shift;
+  } else {
+    milli = 0;
   }
-  *buf = '\0';
-  return buf - start;
+
+  if (negative)
+    return milli > (uint64_t) INT32_MAX + 1 ? INT32_MIN : (int32_t) -milli;
+  return milli > INT32_MAX ? INT32_MAX : (int32_t) milli;
+}
+
+uint64_t time_now_ms() {
+  time_t s;
+  uint16_t ms;
+  time_ms(&s, &ms);
+  return ((uint64_t) s) * 1000 + ms;
+}
+
+int format_fixed(char *buf, size_t len, int32_t val, int precision, int width,
+                 const char *suffix) {
+  /* digits are written backwards: 10 digits, the point, up to 9 decimals */
+  char tmp[24];
+  char *p = tmp + sizeof(tmp);
+  uint32_t abs_val = val < 0 ? -(uint32_t) val : (uint32_t) val;
+  int digits = 0;
+  if (precision > 9)
+    precision = 9;
+
+  do {
+    *--p = '0' + abs_val % 10;
+    abs_val /= 10;
+    if (++digits == precision)
+      *--p = '.';
+  } while (abs_val || digits <= precision);
+  if (val < 0)
+    *--p = '-';
+
+  int num_len = tmp + sizeof(tmp) - p;
+  int pos = 0;
+  if (!len)
+    return 0;
+  for (int i = num_len; i < width && pos + 1 < (int) len; ++i)
+    buf[pos++] = ' ';
+  for (; p < tmp + sizeof(tmp) && pos + 1 < (int) len; ++p)
+    buf[pos++] = *p;
+  for (; suffix && *suffix && pos + 1 < (int) len; ++suffix)
+    buf[pos++] = *suffix;
+  buf[pos] = '\0';
+  return pos;
 }
 
+int32_t round_milli(int32_t milli, int precision) {
+  static const int32_t DIV[] = {1000, 100, 10, 1};
+  if (precision < 0)
+    precision = 0;
+  else if (precision > 3)
+    precision = 3;
+  int32_t div = DIV[precision];
+  /* round half away from zero without overflowing near the limits */
+  int32_t val = milli / div;
+  int32_t rem = milli % div;
+  if (2 * rem >= div)
+    val += 1;
+  else if (2 * rem <= -div)
+    val -= 1;
+  return val;
+}
+
+int format_milli(char *buf, size_t len, int32_t milli, int precision,
+                 int width, const char *suffix) {
+  if (precision < 0)
+    precision = 0;
+  else if (precision > 3)
+    precision = 3;
+  return format_fixed(buf, len, round_milli(milli, precision), precision,
+                      width, suffix);
+}
@@ -44,17 +44,44 @@
 #define FIXP_FLOAT(val, deci) ((float)(val) / (deci))
 
 /**
- * Convert a floating point value to a string
- * The full precision is always used: e.g. 0.00 for .0f at precision 2.
- * The maximal precision EPS is set to .00001
+ * Convert the bits of an IEEE 754 single precision float to milli-units
+ * Only integer operations are used, such that no soft-float library calls are
+ * needed. The result is rounded to the nearest milli-unit and saturated to
+ * the int32_t range, NaN is returned as 0.
+ */
+int32_t float_bits_to_milli(uint32_t bits);
+
+/** Current time in ms since the epoch */
+uint64_t time_now_ms();
+
+/**
+ * Convert a fixed point value to a string without floating point math
+ * The full precision is always used: e.g. 0.00 for 0 at precision 2.
  *
- * @param buf   buffer to write the string to. To be safe the buffer must be
- *              1 (sign) + 10 (int) + 1 (.) + precision + 1 (\0) bytes long.
- *              The buffer is not checked for overflows!
- * @param val   float point value to convert
- * @param precision number of decimals to use
+ * @param buf       buffer to write the string to
+ * @param len       size of the buffer, the string is truncated to fit
+ * @param val       value in units of 10^-precision, e.g. 1234 for 12.34
+ * @param precision number of decimals, 0 to 9
+ * @param width     minimal width of the number, padded with leading spaces
+ * @param suffix    appended unit, e.g. " °C" (NULL for none)
+ * @return the length of the string
+ */
+int format_fixed(char *buf, size_t len, int32_t val, int precision, int width,
+                 const char *suffix);
+
+/**
+ * Round a value in milli-units to units of 10^-precision
+ * Halves are rounded away from zero, the precision is limited to 0 to 3.
+ * No intermediate value overflows, also near the int32_t limits.
+ */
+int32_t round_milli(int32_t milli, int precision);
+
+/**
+ * Convert a value in milli-units to a string, rounded to the precision
+ * See format_fixed() for the parameters, the precision is limited to 3.
  */
-int ftoa(char *buf, float val, int precision);
+int format_milli(char *buf, size_t len, int32_t milli, int precision,
+                 int width, const char *suffix);
 
 #endif /* UTILS_H */
 
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2016, Sensirion AG
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Sensirion AG nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host benchmark of the fixed point formatter against the former ftoa
+ *
+ * Both paths turn a milli-unit reading into the text of a value display:
+ * ftoa followed by snprintf of the unit (before), format_milli with the unit
+ * as suffix (now). Build and run from the SensiSmart directory:
+ *
+ *   gcc -std=c99 -O2 -Itools/host -Isrc -o bench_format \
+ *       tools/bench_format.c src/utils.c && ./bench_format
+ */
+
+#include <stdlib.h>
+
+#include "utils.h"
+
+#define EPS .00001
+#define NUM_VALUES 4096
+#define NUM_ROUNDS 250
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms) {
+  time_t now = time(NULL);
+  if (tloc)
+    *tloc = now;
+  if (out_ms)
+    *out_ms = 0;
+  return 0;
+}
+
+/* ftoa as it was in utils.c before format_fixed() replaced it */
+static int ftoa(char *buf, float val, int precision) {
+  char *start = buf;
+  // start with positive/negative
+  if (val < 0) {
+    *(buf++) = '-';
+    val = -val;
+  }
+  // integer value
+  float round = .5f;
+  for (int i = 0; i < precision; ++i)
+    round *= 0.1;
+  val += round;
+  buf += snprintf(buf, 10, "%d", (int)val);
+  // decimals
+  if (precision > 0) {
+    val -= (int) val;
+    *(buf++) = '.';
+    for (int i = 0; i < precision; ++i) {
+      if (val > EPS) {
+        val *= 10;
+        *(buf++) = '0' + (int) val;
+        val -= (int) val;
+      } else {
+        *(buf++) = '0';
+      }
+    }
+  }
+  *buf = '\0';
+  return buf - start;
+}
+
+static int format_ftoa(char *buf, size_t len, int32_t milli, int precision) {
+  char num[16];
+  ftoa(num, milli / 1000.f, precision);
+  return snprintf(buf, len, "%s °C", num);
+}
+
+static int format_int(char *buf, size_t len, int32_t milli, int precision) {
+  return format_milli(buf, len, milli, precision, 0, " °C");
+}
+
+static double bench(const char *name, const int32_t *values, int precision,
+                    int (*format)(char *, size_t, int32_t, int)) {
+  char buf[32];
+  unsigned long sink = 0;
+  clock_t start = clock();
+  for (int r = 0; r < NUM_ROUNDS; ++r)
+    for (int i = 0; i < NUM_VALUES; ++i)
+      sink += format(buf, sizeof(buf), values[i], precision);
+  double ns = (double) (clock() - start) / CLOCKS_PER_SEC * 1e9 /
+              ((double) NUM_ROUNDS * NUM_VALUES);
+  printf("%-12s precision %d: %7.1f ns/value (%lu)\n", name, precision, ns,
+         sink);
+  return ns;
+}
+
+int main() {
+  static int32_t values[NUM_VALUES];
+  /* readings in the range of the screens, -20.000 to 60.000 */
+  srand(42);
+  for (int i = 0; i < NUM_VALUES; ++i)
+    values[i] = rand() % 80001 - 20000;
+
+  for (int precision = 0; precision <= 3; ++precision) {
+    int mismatches = 0;
+    char a[32], b[32];
+    for (int i = 0; i < NUM_VALUES; ++i) {
+      format_ftoa(a, sizeof(a), values[i], precision);
+      format_int(b, sizeof(b), values[i], precision);
+      mismatches += strcmp(a, b) != 0;
+    }
+    double before = bench("ftoa", values, precision, format_ftoa);
+    double after = bench("format_milli", values, precision, format_int);
+    /* ftoa rounds in float and prints -0, format_milli rounds exactly */
+    printf("  speedup %.1fx, %d of %d texts differ\n", before / after,
+           mismatches, NUM_VALUES);
+  }
+  return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * Host stand-in for the phone side of the log export
+ *
+ * Runs src/js/pebble-js-app.js under node with a minimal Pebble and
+ * localStorage, feeds it the messages the watch sends for a whole log export
+ * (same batching, session headers and sequence numbers as log_export.c) and
+ * measures how fast the receiver reassembles them. The CSV is checked for
+ * one row per entry and a time for every row. Run from the SensiSmart
+ * directory:
+ *
+ *   node tools/host/export_receiver.js [sessions] [entries] [mask]
+ */
+
+var fs = require('fs');
+var path = require('path');
+var vm = require('vm');
+
+var OUTBOX_SIZE = 1024;
+/* dictionary header and 7 uint32 tuples, see log_export_start() */
+var OVERHEAD = 1 + 7 * (7 + 4);
+
+var numSessions = Number(process.argv[2] || 3);
+var entriesPerSession = Number(process.argv[3] || 20000);
+var mask = Number(process.argv[4] || 0x0020000f);
+
+var listeners = {};
+var storage = {};
+var sandbox = {
+  console: { log: function() {} },
+  Pebble: {
+    addEventListener: function(name, cb) { listeners[name] = cb; },
+    sendAppMessage: function() {},
+    openURL: function() {}
+  },
+  localStorage: {
+    getItem: function(k) { return k in storage ? storage[k] : null; },
+    setItem: function(k, v) { storage[k] = String(v); },
+    removeItem: function(k) { delete storage[k]; }
+  }
+};
+vm.runInNewContext(
+    fs.readFileSync(path.join(__dirname, '../../src/js/pebble-js-app.js')),
+    sandbox);
+
+var numChannels = 0;
+for (var m = mask; m; m >>>= 1)
+  numChannels += m & 1;
+var batch = Math.floor((OUTBOX_SIZE - OVERHEAD) / 4);
+batch -= batch % numChannels;
+
+/* messages of the whole export, built up front so only receiving is timed */
+var messages = [];
+var seq = 0;
+var total = 0;
+var bytes = 0;
+for (var s = 0; s < numSessions; ++s) {
+  var left = entriesPerSession * numChannels;
+  var header = true;
+  while (left) {
+    var n = Math.min(batch, left);
+    var data = new Array(n * 4);
+    for (var i = 0; i < n; ++i) {
+      var v = (total + i) * 7 - 50000;
+      data[4 * i] = v & 0xff;
+      data[4 * i + 1] = (v >> 8) & 0xff;
+      data[4 * i + 2] = (v >> 16) & 0xff;
+      data[4 * i + 3] = (v >> 24) & 0xff;
+    }
+    var dict = { EXPORT_SEQ: seq, EXPORT_DATA: data };
+    if (seq === 0)
+      dict.EXPORT_BEGIN = mask;
+    if (header) {
+      dict.EXPORT_SESSION = s + 1;
+      dict.EXPORT_START_TIME = 1500000000 + s * 3600;
+      dict.EXPORT_INTERVAL = 100;
+      header = false;
+    }
+    left -= n;
+    total += n;
+    bytes += n * 4;
+    if (s === numSessions - 1 && !left)
+      dict.EXPORT_END = total;
+    messages.push({ payload: dict });
+    seq += 1;
+  }
+}
+
+var start = process.hrtime();
+for (var j = 0; j < messages.length; ++j)
+  listeners.appmessage(messages[j]);
+var elapsed = process.hrtime(start);
+var ms = elapsed[0] * 1e3 + elapsed[1] / 1e6;
+
+var csv = storage['export-1500000000'];
+if (!csv) {
+  console.log('FAIL: no export stored');
+  process.exit(1);
+}
+var rows = csv.split('\n');
+var ok = rows.length - 1 === numSessions * entriesPerSession;
+for (var r = 1; ok && r < rows.length; ++r) {
+  var cols = rows[r].split(',');
+  var session = Math.floor((r - 1) / entriesPerSession);
+  var entry = (r - 1) % entriesPerSession;
+  ok = Number(cols[0]) === session + 1 &&
+       Number(cols[1]) === (1500000000 + session * 3600) * 1000 + entry * 100;
+}
+console.log(messages.length + ' messages, ' + total + ' samples, ' + bytes +
+            ' B received in ' + ms.toFixed(1) + ' ms (' +
+            Math.round(bytes * 1000 / ms) + ' B/s)');
+console.log(ok ? 'CSV rows and times OK' : 'FAIL: unexpected CSV rows');
+process.exit(ok ? 0 : 1);